@@ -0,0 +1,244 @@
+//
+//  main.swift
+//  OneTimePadBenchmarks
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import Darwin
+import Foundation
+import OneTimePad
+
+// Measures throughput and per-operation latency of the OneTimePad primitives,
+// writing the results to standard output as JSON.
+//
+// Usage: OneTimePadBenchmarks [--quick] [--filter <substring>]
+//   --quick   Limit payloads to 1 MB, for a fast smoke run.
+//   --filter  Only run benchmarks whose name contains the substring.
+//
+// Run from a Release build; unoptimized numbers are not meaningful.
+
+// MARK: - Options
+
+let arguments = Process.arguments
+let isQuick = arguments.contains("--quick")
+let filter: String? = arguments.indexOf("--filter").flatMap { index in
+    index + 1 < arguments.count ? arguments[index + 1] : nil
+}
+
+let payloadSizes = [ 16, 64, 256, 1024, 4096, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024 ].filter {
+    !isQuick || $0 <= 1024 * 1024
+}
+let randomSizes = [ 16, 32, 64, 256, 1024, 4096, 64 * 1024, 1024 * 1024 ]
+let streamingChunkSize = 64 * 1024
+
+// MARK: - Timing
+
+let timebase: mach_timebase_info_data_t = {
+    var info = mach_timebase_info_data_t()
+    mach_timebase_info(&info)
+    return info
+}()
+
+func nanoseconds(ticks: UInt64) -> Double {
+    return Double(ticks) * Double(timebase.numer) / Double(timebase.denom)
+}
+
+/// Enough samples for stable percentiles on small payloads, without spending
+/// minutes on the largest ones.
+func iterationCount(forBytes bytes: Int) -> Int {
+    return min(max((256 * 1024 * 1024) / max(bytes, 1), 5), 2000)
+}
+
+func percentile(sorted: [Double], _ p: Double) -> Double {
+    let rank = Int(p / 100 * Double(sorted.count - 1) + 0.5)
+    return sorted[rank]
+}
+
+var results = [[String: AnyObject]]()
+
+/// Time `body` over `bytes` of input, recording a result.
+///
+/// One warm-up run is made first; if it throws, the benchmark is recorded as
+/// unsupported rather than aborting the suite.
+func measure(name: String, parameters: [String: AnyObject], bytes: Int, body: () throws -> Void) {
+    if let filter = filter where !name.containsString(filter) {
+        return
+    }
+    
+    var result = parameters
+    result["name"] = name
+    result["bytes"] = bytes
+    
+    do {
+        try body()
+    } catch {
+        result["error"] = String(error)
+        results.append(result)
+        return
+    }
+    
+    let iterations = iterationCount(forBytes: bytes)
+    var samples = [Double]()
+    samples.reserveCapacity(iterations)
+    for _ in 0 ..< iterations {
+        let start = mach_absolute_time()
+        try! body()
+        samples.append(nanoseconds(mach_absolute_time() - start))
+    }
+    samples.sortInPlace()
+    
+    let total = samples.reduce(0, combine: +)
+    let median = percentile(samples, 50)
+    result["iterations"] = iterations
+    result["latency_ns"] = [
+        "min": samples.first!,
+        "mean": total / Double(iterations),
+        "p50": median,
+        "p90": percentile(samples, 90),
+        "p99": percentile(samples, 99),
+        "max": samples.last!
+    ]
+    // A tiny payload can finish within one tick; clamp to a tick so that
+    // the throughput stays finite.
+    let throughput = Double(bytes) / (max(median, nanoseconds(1)) / 1e9) / 1e6
+    result["throughput_mb_s"] = throughput
+    results.append(result)
+    
+    let status = "\(name) \(bytes) B: \(Int(throughput)) MB/s\n"
+    fputs(status, stderr)
+}
+
+// MARK: - Buffers
+
+func makeStorage(count: Int) -> UnsafeMutablePointer<UInt8> {
+    let bytes = UnsafeMutablePointer<UInt8>.alloc(count)
+    for i in 0 ..< count {
+        bytes[i] = UInt8(truncatingBitPattern: i &* 31)
+    }
+    return bytes
+}
+
+let inputCapacity = payloadSizes.last!
+let outputCapacity = inputCapacity + 64
+let inputStorage = makeStorage(inputCapacity)
+let outputStorage = makeStorage(outputCapacity)
+let keyStorage = makeStorage(64)
+let ivStorage = makeStorage(16)
+
+func input(count: Int, offset: Int = 0) -> UnsafeBufferPointer<Void> {
+    return UnsafeBufferPointer(start: inputStorage + offset, count: count)
+}
+
+func output(offset offset: Int = 0) -> UnsafeMutableBufferPointer<Void> {
+    return UnsafeMutableBufferPointer(start: outputStorage + offset, count: outputCapacity - offset)
+}
+
+func key(count: Int) -> UnsafeBufferPointer<Void> {
+    return UnsafeBufferPointer(start: keyStorage, count: count)
+}
+
+let iv = UnsafePointer<Void>(ivStorage)
+let tweak = UnsafeBufferPointer<Void>(start: keyStorage + 32, count: 16)
+
+// MARK: - Cryptor
+
+typealias CryptorCase = (algorithm: String, mode: String, value: Cryptor.Algorithm, keyLength: Int)
+
+let modes: [(String, Cryptor.Mode)] = [
+    ("ECB", .ECB),
+    ("CBC", .CBC(iv: iv)),
+    ("CFB", .CFB(iv: iv)),
+    ("CTR", .CTR(iv: iv)),
+    ("OFB", .OFB(iv: iv)),
+    ("XTS", .XTS(tweak: tweak)),
+    ("CFB8", .CFB8(iv: iv, numberOfRounds: 0))
+]
+
+var cryptorCases = [CryptorCase]()
+for (modeName, mode) in modes {
+    cryptorCases.append(("AES128", modeName, .AES(mode, .None), 16))
+    cryptorCases.append(("AES256", modeName, .AES(mode, .None), 32))
+    cryptorCases.append(("DES", modeName, .DES(mode, .None), 8))
+    cryptorCases.append(("TripleDES", modeName, .TripleDES(mode, .None), 24))
+    cryptorCases.append(("CAST", modeName, .CAST(mode, .None), 16))
+    cryptorCases.append(("Blowfish", modeName, .Blowfish(mode, .None), 16))
+}
+cryptorCases.append(("RC4", "Stream", .RC4, 16))
+
+for c in cryptorCases {
+    let parameters: [String: AnyObject] = [ "algorithm": c.algorithm, "mode": c.mode ]
+    for size in payloadSizes where size % max(c.value.blockSize, 1) == 0 {
+        measure("cryptor.oneshot", parameters: parameters, bytes: size) {
+            var out: UnsafeMutableBufferPointer<Void>! = output()
+            _ = try Cryptor.encryptWithAlgorithm(algorithm: c.value, key: key(c.keyLength), input: input(size), output: &out)
+        }
+        
+        measure("cryptor.streaming", parameters: parameters, bytes: size) {
+            let cryptor = try Cryptor(forEncryption: c.value, key: key(c.keyLength))
+            var written = 0
+            var offset = 0
+            while offset < size {
+                let length = min(streamingChunkSize, size - offset)
+                var out: UnsafeMutableBufferPointer<Void>! = output(offset: written)
+                written += try cryptor.update(input(length, offset: offset), output: &out)
+                offset += length
+            }
+            var out = output(offset: written)
+            _ = try cryptor.finalize(&out)
+        }
+    }
+}
+
+// MARK: - Digest and HMAC
+
+let digestCases: [(String, Digest.Algorithm)] = [ ("MD5", .MD5), ("SHA1", .SHA1), ("SHA224", .SHA224), ("SHA256", .SHA256), ("SHA384", .SHA384), ("SHA512", .SHA512) ]
+
+for (name, algorithm) in digestCases {
+    let parameters: [String: AnyObject] = [ "algorithm": name ]
+    for size in payloadSizes {
+        measure("digest.oneshot", parameters: parameters, bytes: size) {
+            var out = output()
+            _ = try Digest.digestWithAlgorithm(algorithm: algorithm, data: input(size), output: &out)
+        }
+        
+        let hmac = HMAC(algorithm: algorithm, key: key(32))
+        measure("hmac.keyed", parameters: parameters, bytes: size) {
+            var out = output()
+            _ = try hmac.authenticate(input(size), output: &out)
+        }
+    }
+}
+
+// MARK: - Random
+
+for size in randomSizes {
+    var bytes = [UInt8](count: size, repeatedValue: 0)
+    measure("random.fill", parameters: [:], bytes: size) {
+        try bytes.fillWithRandomData()
+    }
+    
+    measure("random.pooled", parameters: [:], bytes: size) {
+        try bytes.fillWithPooledRandomData()
+    }
+    
+    measure("random.init", parameters: [:], bytes: size) {
+        _ = try [UInt8](randomCount: size)
+    }
+}
+
+// MARK: - Report
+
+let report: [String: AnyObject] = [
+    "date": NSDateFormatter.localizedStringFromDate(NSDate(), dateStyle: .ShortStyle, timeStyle: .LongStyle),
+    "timestamp": NSDate().timeIntervalSince1970,
+    "os": NSProcessInfo.processInfo().operatingSystemVersionString,
+    "processors": NSProcessInfo.processInfo().activeProcessorCount,
+    "quick": isQuick,
+    "results": results
+]
+
+let json = try! NSJSONSerialization.dataWithJSONObject(report, options: .PrettyPrinted)
+NSFileHandle.fileHandleWithStandardOutput().writeData(json)
+print("")
@@ -38,6 +38,7 @@ typedef CF_ENUM(uint32_t, CCMode) {
 	kCCModeXTS                   = 8,
 	kCCModeRC4                   = 9,
 	kCCModeCFB8                  = 10,
+	kCCModeGCM                   = 11,
 };
 
 typedef CF_ENUM(uint32_t, CCPadding) {
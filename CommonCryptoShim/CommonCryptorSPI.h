@@ -0,0 +1,40 @@
+/*
+ * CommonCryptorSPI.h - Private interfaces for symmetric encryption.
+ * Copyright (c) 2010-2014 Apple Inc. All Rights Reserved. Licensed under APSL.
+ */
+
+#import <CoreFoundation/CoreFoundation.h>
+#import "CommonCryptor.h"
+
+CF_ASSUME_NONNULL_BEGIN
+
+/*
+ * Galois/Counter Mode, for a cryptor created with kCCModeGCM and
+ * kCCAlgorithmAES. After creation or CCCryptorGCMReset, the IV must be added
+ * first, then any additional authenticated data, then the text. The tag is
+ * produced by CCCryptorGCMFinal for both operations; when decrypting, it is
+ * the caller's responsibility to compare it against the expected tag.
+ */
+extern CCCryptorStatus CCCryptorGCMAddIV(CCCryptorRef cryptorRef, const void *iv, size_t ivLen) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorGCMAddAAD(CCCryptorRef cryptorRef, const void *_Nullable aData, size_t aDataLen) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorGCMEncrypt(CCCryptorRef cryptorRef, const void *_Nullable dataIn, size_t dataInLength, void *_Nullable dataOut) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorGCMDecrypt(CCCryptorRef cryptorRef, const void *_Nullable dataIn, size_t dataInLength, void *_Nullable dataOut) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorGCMFinal(CCCryptorRef cryptorRef, void *tagOut, size_t *tagLength) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorGCMReset(CCCryptorRef cryptorRef) CF_AVAILABLE(10_8, 5_0);
+
+/*
+ * Process one data unit with an explicit IV, for a cryptor created with
+ * kCCModeXTS. The IV is the tweak value for the data unit; the cryptor's
+ * state is not otherwise changed, so one cryptor can process any number of
+ * data units in any order.
+ */
+extern CCCryptorStatus CCCryptorEncryptDataBlock(CCCryptorRef cryptorRef, const void *iv, const void *dataIn, size_t dataInLength, void *dataOut) CF_AVAILABLE(10_8, 5_0);
+
+extern CCCryptorStatus CCCryptorDecryptDataBlock(CCCryptorRef cryptorRef, const void *iv, const void *dataIn, size_t dataInLength, void *dataOut) CF_AVAILABLE(10_8, 5_0);
+
+CF_ASSUME_NONNULL_END
@@ -0,0 +1,117 @@
+/*
+ * CommonDigest.h - Common digest routines: MD5, SHA-1, SHA-2.
+ * Copyright (c) 2006-2014 Apple Inc. All Rights Reserved. Licensed under APSL.
+ */
+
+#import <CoreFoundation/CoreFoundation.h>
+#import "CommonCryptoError.h"
+
+CF_ASSUME_NONNULL_BEGIN
+
+/*
+ * For compatibility with legacy implementations, the *Init(), *Update(),
+ * and *Final() functions declared here *always* return a value of 1 (one).
+ * There are no errors of any kind which can be, or are, reported here.
+ *
+ * The one-shot functions (CC_SHA1(), etc.) perform digest calculation and
+ * place the result in the caller-supplied buffer indicated by the md
+ * parameter. They return the md parameter.
+ *
+ * MD2 and MD4 are deliberately not audited.
+ */
+
+typedef uint32_t CC_LONG;
+typedef uint64_t CC_LONG64;
+
+enum: uint32_t {
+    CC_MD5_DIGEST_LENGTH    = 16,
+    CC_MD5_BLOCK_BYTES      = 64,
+    CC_SHA1_DIGEST_LENGTH   = 20,
+    CC_SHA1_BLOCK_BYTES     = 64,
+    CC_SHA224_DIGEST_LENGTH = 28,
+    CC_SHA224_BLOCK_BYTES   = 64,
+    CC_SHA256_DIGEST_LENGTH = 32,
+    CC_SHA256_BLOCK_BYTES   = 64,
+    CC_SHA384_DIGEST_LENGTH = 48,
+    CC_SHA384_BLOCK_BYTES   = 128,
+    CC_SHA512_DIGEST_LENGTH = 64,
+    CC_SHA512_BLOCK_BYTES   = 128,
+};
+
+typedef struct CC_MD5state_st {
+    CC_LONG A, B, C, D;
+    CC_LONG Nl, Nh;
+    CC_LONG data[CC_MD5_BLOCK_BYTES / sizeof(CC_LONG)];
+    int num;
+} CC_MD5_CTX;
+
+extern int CC_MD5_Init(CC_MD5_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_MD5_Update(CC_MD5_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_MD5_Final(unsigned char *md, CC_MD5_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_MD5(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+typedef struct CC_SHA1state_st {
+    CC_LONG h0, h1, h2, h3, h4;
+    CC_LONG Nl, Nh;
+    CC_LONG data[CC_SHA1_BLOCK_BYTES / sizeof(CC_LONG)];
+    int num;
+} CC_SHA1_CTX;
+
+extern int CC_SHA1_Init(CC_SHA1_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA1_Update(CC_SHA1_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA1_Final(unsigned char *md, CC_SHA1_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_SHA1(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+/* Same context struct is used for SHA-224 and SHA-256. */
+typedef struct CC_SHA256state_st {
+    CC_LONG count[2];
+    CC_LONG hash[8];
+    CC_LONG wbuf[16];
+} CC_SHA256_CTX;
+
+extern int CC_SHA224_Init(CC_SHA256_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA224_Update(CC_SHA256_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA224_Final(unsigned char *md, CC_SHA256_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_SHA224(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA256_Init(CC_SHA256_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA256_Update(CC_SHA256_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA256_Final(unsigned char *md, CC_SHA256_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_SHA256(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+/* Same context struct is used for SHA-384 and SHA-512. */
+typedef struct CC_SHA512state_st {
+    CC_LONG64 count[2];
+    CC_LONG64 hash[8];
+    CC_LONG64 wbuf[16];
+} CC_SHA512_CTX;
+
+extern int CC_SHA384_Init(CC_SHA512_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA384_Update(CC_SHA512_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA384_Final(unsigned char *md, CC_SHA512_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_SHA384(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA512_Init(CC_SHA512_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA512_Update(CC_SHA512_CTX *c, const void *data, CC_LONG len) CF_AVAILABLE(10_4, 2_0);
+
+extern int CC_SHA512_Final(unsigned char *md, CC_SHA512_CTX *c) CF_AVAILABLE(10_4, 2_0);
+
+extern unsigned char *CC_SHA512(const void *data, CC_LONG len, unsigned char *md) CF_AVAILABLE(10_4, 2_0);
+
+CF_ASSUME_NONNULL_END
@@ -0,0 +1,40 @@
+/*
+ * CommonHMAC.h - Keyed Message Authentication Code (HMAC) functions.
+ * Copyright (c) 2004-2014 Apple Inc. All Rights Reserved. Licensed under APSL.
+ */
+
+#import <CoreFoundation/CoreFoundation.h>
+#import "CommonDigest.h"
+
+CF_ASSUME_NONNULL_BEGIN
+
+typedef CF_ENUM(uint32_t, CCHmacAlgorithm) {
+    kCCHmacAlgSHA1,
+    kCCHmacAlgMD5,
+    kCCHmacAlgSHA256,
+    kCCHmacAlgSHA384,
+    kCCHmacAlgSHA512,
+    kCCHmacAlgSHA224
+};
+
+enum: uint32_t {
+    CC_HMAC_CONTEXT_SIZE = 96
+};
+
+/*
+ * The context holds no pointers into itself; it is safe to copy a keyed
+ * context by value.
+ */
+typedef struct {
+    uint32_t ctx[CC_HMAC_CONTEXT_SIZE];
+} CCHmacContext;
+
+extern void CCHmacInit(CCHmacContext *ctx, CCHmacAlgorithm algorithm, const void *_Nullable key, size_t keyLength) CF_AVAILABLE(10_4, 2_0);
+
+extern void CCHmacUpdate(CCHmacContext *ctx, const void *_Nullable data, size_t dataLength) CF_AVAILABLE(10_4, 2_0);
+
+extern void CCHmacFinal(CCHmacContext *ctx, void *macOut) CF_AVAILABLE(10_4, 2_0);
+
+extern void CCHmac(CCHmacAlgorithm algorithm, const void *_Nullable key, size_t keyLength, const void *_Nullable data, size_t dataLength, void *macOut) CF_AVAILABLE(10_4, 2_0);
+
+CF_ASSUME_NONNULL_END
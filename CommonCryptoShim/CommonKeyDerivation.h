@@ -0,0 +1,39 @@
+/*
+ * CommonKeyDerivation.h - Password-based key derivation functions.
+ * Copyright (c) 2010 Apple Inc. All Rights Reserved. Licensed under APSL.
+ */
+
+#import <CoreFoundation/CoreFoundation.h>
+#import "CommonCryptoError.h"
+
+CF_ASSUME_NONNULL_BEGIN
+
+typedef uint32_t CCPBKDFAlgorithm;
+
+enum: CCPBKDFAlgorithm {
+    kCCPBKDF2 = 2
+};
+
+typedef uint32_t CCPseudoRandomAlgorithm;
+
+enum: CCPseudoRandomAlgorithm {
+    kCCPRFHmacAlgSHA1   = 1,
+    kCCPRFHmacAlgSHA224 = 2,
+    kCCPRFHmacAlgSHA256 = 3,
+    kCCPRFHmacAlgSHA384 = 4,
+    kCCPRFHmacAlgSHA512 = 5
+};
+
+/*
+ * The password is used as raw octets, with no additional processing; the
+ * caller is responsible for consistent encoding and normalization.
+ */
+extern CCStatus CCKeyDerivationPBKDF(CCPBKDFAlgorithm algorithm, const char *password, size_t passwordLen, const uint8_t *_Nullable salt, size_t saltLen, CCPseudoRandomAlgorithm prf, uint32_t rounds, uint8_t *derivedKey, size_t derivedKeyLen) CF_AVAILABLE(10_7, 5_0);
+
+/*
+ * Returns the number of rounds needed for a derivation with the given
+ * parameters to take approximately `msec` milliseconds on this device.
+ */
+extern uint32_t CCCalibratePBKDF(CCPBKDFAlgorithm algorithm, size_t passwordLen, size_t saltLen, CCPseudoRandomAlgorithm prf, size_t derivedKeyLen, uint32_t msec) CF_AVAILABLE(10_7, 5_0);
+
+CF_ASSUME_NONNULL_END
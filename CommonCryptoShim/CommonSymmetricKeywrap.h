@@ -0,0 +1,34 @@
+/*
+ * CommonSymmetricKeywrap.h - Symmetric key wrapping (RFC 3394).
+ * Copyright (c) 2010 Apple Inc. All Rights Reserved. Licensed under APSL.
+ */
+
+#import <CoreFoundation/CoreFoundation.h>
+#import "CommonCryptoError.h"
+
+CF_ASSUME_NONNULL_BEGIN
+
+typedef uint32_t CCWrappingAlgorithm;
+
+enum: CCWrappingAlgorithm {
+    kCCWRAPAES = 1
+};
+
+/* The standard RFC 3394 initial value, and its length. */
+extern const uint8_t *const CCrfc3394_iv CF_AVAILABLE(10_6, 5_0);
+extern const size_t CCrfc3394_ivLen CF_AVAILABLE(10_6, 5_0);
+
+/*
+ * The AES variant is chosen by the length of the KEK. On input,
+ * `wrappedKeyLen`/`rawKeyLen` is the space available; on return, the
+ * number of bytes written.
+ */
+extern CCStatus CCSymmetricKeyWrap(CCWrappingAlgorithm algorithm, const uint8_t *iv, const size_t ivLen, const uint8_t *kek, size_t kekLen, const uint8_t *rawKey, size_t rawKeyLen, uint8_t *wrappedKey, size_t *wrappedKeyLen) CF_AVAILABLE(10_7, 5_0);
+
+extern CCStatus CCSymmetricKeyUnwrap(CCWrappingAlgorithm algorithm, const uint8_t *iv, const size_t ivLen, const uint8_t *kek, size_t kekLen, const uint8_t *wrappedKey, size_t wrappedKeyLen, uint8_t *rawKey, size_t *rawKeyLen) CF_AVAILABLE(10_7, 5_0);
+
+extern size_t CCSymmetricWrappedSize(CCWrappingAlgorithm algorithm, size_t rawKeyLen) CF_AVAILABLE(10_7, 5_0);
+
+extern size_t CCSymmetricUnwrappedSize(CCWrappingAlgorithm algorithm, size_t wrappedKeyLen) CF_AVAILABLE(10_7, 5_0);
+
+CF_ASSUME_NONNULL_END
@@ -0,0 +1,129 @@
+//
+//  AsyncCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+import Foundation
+
+public extension Cryptor {
+    
+    /// The default queue for asynchronous operations: concurrent, at utility
+    /// quality of service.
+    static let asynchronousQueue = dispatch_queue_create("me.waldowski.OneTimePad.Cryptor.async", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT, QOS_CLASS_UTILITY, 0))
+    
+    /// Process (encrypt or decrypt) a buffer asynchronously, then finalize.
+    ///
+    /// The input is passed to `update` one chunk at a time, each chunk as a
+    /// separate block submitted to `queue`, so a large payload neither blocks
+    /// the caller nor monopolizes a worker thread. Chunks are processed in
+    /// order, never concurrently, even on a concurrent queue.
+    ///
+    /// An `NSProgress` is created as a child of the current progress, if any,
+    /// with one unit of work per byte of input. Cancelling it stops the
+    /// operation before the next chunk.
+    ///
+    /// As with `update`, the `Cryptor` should be freshly created or `reset`,
+    /// and not used elsewhere until `completion` is called.
+    ///
+    /// - parameter input: Data to process. Must remain valid until
+    ///   `completion` is called.
+    /// - parameter output: The result is written here. Must be allocated by
+    ///   the caller with space for at least
+    ///   `outputLengthForInputLength(input.count, finalizing: true)` bytes,
+    ///   and remain valid until `completion` is called.
+    /// - parameter chunkSize: The number of bytes passed to each call to
+    ///   `update`. If `nil`, `preferredChunkSize` is used, resolved on
+    ///   `queue` so that any tuning does not block the caller.
+    /// - parameter queue: The queue on which chunks are processed and
+    ///   `completion` is called.
+    /// - parameter completion: Called once, with a function that returns the
+    ///   number of bytes written to `output` or throws the error that stopped
+    ///   the operation: any error thrown by `update` or `finalize`, or
+    ///   `NSUserCancelledError` in `NSCocoaErrorDomain` if the progress was
+    ///   cancelled.
+    /// - returns: The progress of the operation.
+    func process(input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, chunkSize: Int? = nil, queue: dispatch_queue_t = Cryptor.asynchronousQueue, completion: (() throws -> Int) -> Void) -> NSProgress {
+        let progress = NSProgress(totalUnitCount: Int64(input.count))
+        var chunkSize = chunkSize.map { max($0, 1) }
+        let bytesIn = UnsafePointer<UInt8>(input.baseAddress)
+        let bytesOut = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        var read = 0
+        var written = 0
+        
+        func step() {
+            do {
+                guard !progress.cancelled else {
+                    throw NSError(domain: NSCocoaErrorDomain, code: NSUserCancelledError, userInfo: nil)
+                }
+                
+                if read < input.count {
+                    let size = chunkSize ?? max(preferredChunkSize, 1)
+                    chunkSize = size
+                    let count = min(size, input.count - read)
+                    var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: bytesOut + written, count: output.count - written)
+                    written += try update(UnsafeBufferPointer(start: bytesIn + read, count: count), output: &out)
+                    read += count
+                    progress.completedUnitCount = Int64(read)
+                    dispatch_async(queue, step)
+                    return
+                }
+                
+                var out = UnsafeMutableBufferPointer<Void>(start: bytesOut + written, count: output.count - written)
+                written += try finalize(&out)
+                let result = written
+                completion { result }
+            } catch {
+                completion { throw error }
+            }
+        }
+        
+        dispatch_async(queue, step)
+        return progress
+    }
+    
+    private static func cryptWithAlgorithm(operation op: Operation, algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, queue: dispatch_queue_t, completion: (() throws -> Int) -> Void) -> NSProgress {
+        do {
+            try neededOutputLength(algorithm: alg, operation: op, input: input, output: output)
+            let cryptor = try Cryptor(operation: op.rawValue, configuration: Configuration(alg), key: key)
+            return cryptor.process(input, output: output, queue: queue, completion: completion)
+        } catch {
+            let progress = NSProgress(totalUnitCount: Int64(input.count))
+            dispatch_async(queue) {
+                completion { throw error }
+            }
+            return progress
+        }
+    }
+    
+    /// Asynchronous one-shot encryption.
+    ///
+    /// The cryptor is created before returning, so `key` need only be valid
+    /// for the duration of the call; `input` and `output` must remain valid
+    /// until `completion` is called.
+    ///
+    /// - parameter queue: The queue on which the data is processed and
+    ///   `completion` is called.
+    /// - parameter completion: Called once, with a function that returns the
+    ///   number of bytes written to `output` or throws. If `output` is too
+    ///   small, it throws `OneShotError.BufferTooSmall` before any work.
+    /// - returns: The progress of the operation. Cancelling it stops the
+    ///   operation before the next chunk.
+    /// - seealso: Cryptor.encryptWithAlgorithm(algorithm:key:input:output:)
+    /// - seealso: process(_:output:chunkSize:queue:completion:)
+    static func encryptWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, queue: dispatch_queue_t = Cryptor.asynchronousQueue, completion: (() throws -> Int) -> Void) -> NSProgress {
+        return cryptWithAlgorithm(operation: .Encrypt, algorithm: alg, key: key, input: input, output: output, queue: queue, completion: completion)
+    }
+    
+    /// Asynchronous one-shot decryption.
+    ///
+    /// - seealso: encryptWithAlgorithm(algorithm:key:input:output:queue:completion:)
+    static func decryptWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, queue: dispatch_queue_t = Cryptor.asynchronousQueue, completion: (() throws -> Int) -> Void) -> NSProgress {
+        return cryptWithAlgorithm(operation: .Decrypt, algorithm: alg, key: key, input: input, output: output, queue: queue, completion: completion)
+    }
+    
+}
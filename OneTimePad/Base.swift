@@ -7,6 +7,9 @@
 //
 
 import CommonCryptoShim.Private
+import Darwin
+import Dispatch
+import Foundation
 
 protocol UnsafeInit {
     init()
@@ -20,14 +23,28 @@ protocol CCPointer {
 }
 
 func cc_call(@noescape fn: Void -> CCStatus) throws {
+    probe(.Call)
     switch fn() {
     case CCSuccess:
         break
     case let error:
+        probe(.Failure(error))
         throw CryptoError(error)
     }
 }
 
+func posixError(code: Int32) -> ErrorType {
+    return NSError(domain: NSPOSIXErrorDomain, code: Int(code), userInfo: nil)
+}
+
+func posix_call(@noescape fn: Void -> Int32) throws -> Int32 {
+    let ret = fn()
+    guard ret != -1 else {
+        throw posixError(errno)
+    }
+    return ret
+}
+
 extension CCPointer {
     
     static func call(@noescape fn: Void -> CCStatus) throws {
@@ -47,3 +64,110 @@ extension CCPointer {
     }
     
 }
+
+/// A mutual exclusion lock with scoped acquisition.
+final class Mutex {
+    
+    private let raw = UnsafeMutablePointer<pthread_mutex_t>.alloc(1)
+    
+    init() {
+        pthread_mutex_init(raw, nil)
+    }
+    
+    deinit {
+        pthread_mutex_destroy(raw)
+        raw.dealloc(1)
+    }
+    
+    func withLock<Return>(@noescape body: Void throws -> Return) rethrows -> Return {
+        pthread_mutex_lock(raw)
+        defer { pthread_mutex_unlock(raw) }
+        return try body()
+    }
+    
+}
+
+/// Call `body` for each index in `0 ..< iterations` concurrently on `queue`,
+/// as with `dispatch_apply`, then rethrow the first error thrown.
+///
+/// Once an iteration throws, iterations that have not yet started are
+/// skipped; those already running finish.
+func concurrentlyApply(iterations: Int, queue: dispatch_queue_t, body: Int throws -> Void) throws {
+    let lock = Mutex()
+    var firstError: ErrorType?
+    dispatch_apply(iterations, queue) { index in
+        guard lock.withLock({ firstError == nil }) else { return }
+        do {
+            try body(index)
+        } catch {
+            lock.withLock {
+                if firstError == nil { firstError = error }
+            }
+        }
+    }
+    
+    if let error = firstError {
+        throw error
+    }
+}
+
+/// Compare two regions of memory in time that depends only on `count`.
+///
+/// Every byte is examined, eight at a time, with no early exit; the loop
+/// carries no data-dependent branches, so it is suitable for comparing MACs
+/// and other secrets.
+func constantTimeEquals(lhs: UnsafePointer<Void>, _ rhs: UnsafePointer<Void>, count: Int) -> Bool {
+    let a = UnsafePointer<UInt8>(lhs)
+    let b = UnsafePointer<UInt8>(rhs)
+    let wordSize = sizeof(UInt64)
+    var difference: UInt64 = 0
+    var x: UInt64 = 0
+    var y: UInt64 = 0
+    var offset = 0
+    while offset + wordSize <= count {
+        memcpy(&x, a + offset, wordSize)
+        memcpy(&y, b + offset, wordSize)
+        difference |= x ^ y
+        offset += wordSize
+    }
+    while offset < count {
+        difference |= UInt64(a[offset] ^ b[offset])
+        offset += 1
+    }
+    return difference == 0
+}
+
+/// Overwrite memory with zeroes in a way the optimizer will not elide, even
+/// if the memory is about to be freed.
+func secureZero(bytes: UnsafeMutablePointer<Void>, count: Int) {
+    guard bytes != nil && count > 0 else { return }
+    memset_s(bytes, count, 0, count)
+}
+
+/// An owned copy of secret bytes, such as key material, that is wiped when
+/// released.
+final class SecretBytes {
+    
+    private let bytes: UnsafeMutablePointer<UInt8>
+    let count: Int
+    
+    init(copying source: UnsafeBufferPointer<Void>) {
+        count = source.count
+        bytes = UnsafeMutablePointer.alloc(max(count, 1))
+        bytes.initializeFrom(UnsafeMutablePointer(source.baseAddress), count: count)
+    }
+    
+    deinit {
+        secureZero(bytes, count: count)
+        bytes.dealloc(max(count, 1))
+    }
+    
+    var buffer: UnsafeBufferPointer<Void> {
+        return UnsafeBufferPointer(start: UnsafePointer(bytes), count: count)
+    }
+    
+    func matches(other: UnsafeBufferPointer<Void>) -> Bool {
+        return other.count == count && constantTimeEquals(bytes, other.baseAddress, count: count)
+    }
+    
+}
@@ -0,0 +1,175 @@
+//
+//  BatchCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+
+public extension Cryptor {
+    
+    /// One message in a batch: its initialization vector, and its location
+    /// within the batch's input.
+    struct BatchRecord {
+        /// The initialization vector for this message. Must be the same size
+        /// as the algorithm's block size, or `nil` for a zero IV.
+        public var iv: UnsafePointer<Void>
+        /// The byte range of the message in the batch's input.
+        public var input: Range<Int>
+        
+        public init(iv: UnsafePointer<Void>, input: Range<Int>) {
+            self.iv = iv
+            self.input = input
+        }
+    }
+    
+    private static func cryptBatch(operation op: Operation, algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, records: [BatchRecord], input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, inout ranges: [Range<Int>], recordsPerShard: Int, queue: dispatch_queue_t?) throws -> Int {
+        ranges.removeAll(keepCapacity: true)
+        let configuration = Configuration(alg)
+        guard configuration.mode != .RC4 else {
+            throw CryptoError.InvalidParameters
+        }
+        ranges.reserveCapacity(records.count)
+        
+        // Lay out a slot for every record up front, so that shards can write
+        // their output independently.
+        var needed = 0
+        for record in records {
+            guard record.input.startIndex >= 0 && record.input.endIndex <= input.count else {
+                ranges.removeAll(keepCapacity: true)
+                throw CryptoError.InvalidParameters
+            }
+            let length = alg.outputLength(forInput: record.input.count, operation: op)
+            ranges.append(needed ..< needed + length)
+            needed += length
+        }
+        guard output.count >= needed else {
+            ranges.removeAll(keepCapacity: true)
+            throw OneShotError.BufferTooSmall(needed)
+        }
+        
+        let perShard = max(recordsPerShard, 1)
+        let shardCount = queue == nil ? 1 : (records.count + perShard - 1) / perShard
+        let bytesIn = UnsafePointer<UInt8>(input.baseAddress)
+        let bytesOut = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        
+        func cryptShard(index: Int, slots: UnsafeMutablePointer<Range<Int>>) throws {
+            let start = queue == nil ? 0 : index * perShard
+            let end = queue == nil ? records.count : min(start + perShard, records.count)
+            
+            let resettable = configuration.mode.isResettable
+            var cryptor = RawCryptor()
+            if resettable {
+                try createCryptor(operation: op.rawValue, configuration: configuration, key: key, cryptor: &cryptor)
+            }
+            defer {
+                if cryptor != nil {
+                    CCCryptorRelease(cryptor)
+                }
+            }
+            
+            for i in start ..< end {
+                let record = records[i]
+                let slot = slots[i]
+                if resettable {
+                    probe(.Reset)
+                    try cc_call {
+                        CCCryptorReset(cryptor, record.iv)
+                    }
+                } else {
+                    // Reset cannot be trusted to restart the counter or
+                    // feedback register, so start from a fresh context.
+                    if cryptor != nil {
+                        CCCryptorRelease(cryptor)
+                        cryptor = nil
+                    }
+                    let c = configuration
+                    try createCryptor(operation: op.rawValue, configuration: Configuration(mode: c.mode, algorithm: c.algorithm, padding: c.padding, iv: record.iv, tweak: c.tweak, numberOfRounds: c.numberOfRounds), key: key, cryptor: &cryptor)
+                }
+                
+                let data = UnsafeBufferPointer<Void>(start: bytesIn + record.input.startIndex, count: record.input.count)
+                var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: bytesOut + slot.startIndex, count: slot.count)
+                let length = try cryptWithCryptor(cryptor, needed: slot.count, input: data, output: &out)
+                slots[i] = slot.startIndex ..< slot.startIndex + length
+            }
+        }
+        
+        do {
+            try ranges.withUnsafeMutableBufferPointer { (inout ranges: UnsafeMutableBufferPointer<Range<Int>>) in
+                let slots = ranges.baseAddress
+                guard let queue = queue where shardCount > 1 else {
+                    try cryptShard(0, slots: slots)
+                    return
+                }
+                try concurrentlyApply(shardCount, queue: queue) { index in
+                    try cryptShard(index, slots: slots)
+                }
+            }
+        } catch {
+            secureZero(bytesOut, count: needed)
+            ranges.removeAll(keepCapacity: true)
+            throw error
+        }
+        return needed
+    }
+    
+    /// Encrypt many independent messages under the same key, each with its
+    /// own IV.
+    ///
+    /// Rather than creating and releasing a context per message, each shard
+    /// of the batch uses a single cryptor, `reset` with the IV of each
+    /// message in turn. That reset is only reliable for ECB and CBC on the
+    /// deployment target; in other modes each message gets a fresh context,
+    /// so the batch still saves on layout and dispatch, but not on key
+    /// expansion. Messages are read from one contiguous input slab and
+    /// written to one contiguous output slab.
+    ///
+    /// Each message is given a slot in `output` of
+    /// `algorithm.outputLength(forInput:operation:)` bytes, in the order of
+    /// `records`; the space needed is checked for the whole batch before any
+    /// message is processed.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode. Any IV in
+    ///   the mode is ignored in favor of those in `records`. Stream ciphers
+    ///   (i.e., RC4) cannot be used.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - parameter records: The messages to encrypt.
+    /// - parameter input: The slab containing every message.
+    /// - parameter output: The results are written here. Must be allocated by
+    ///   the caller, with space for the sum of each message's slot.
+    /// - parameter ranges: Upon successful return, the byte range in `output`
+    ///   of each encrypted message. Its storage is reused, so passing the
+    ///   same array for every batch avoids allocation.
+    /// - parameter recordsPerShard: The number of messages processed by a
+    ///   single cryptor when the batch is split across threads.
+    /// - parameter queue: If present, shards of the batch are processed
+    ///   concurrently on this queue; it should be concurrent. Otherwise the
+    ///   batch is processed on the calling thread.
+    /// - returns: The number of bytes of `output` spanned by the slots.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` for a stream cipher, or if a
+    ///     record lies outside `input`. No messages will have been processed.
+    ///   - `OneShotError.BufferTooSmall` to indicate insufficient space in
+    ///     the `output` buffer, along with the size needed. No messages will
+    ///     have been processed.
+    ///   - Any error from processing a message. The output is wiped.
+    static func encryptBatchWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, records: [BatchRecord], input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, inout ranges: [Range<Int>], recordsPerShard: Int = 4096, queue: dispatch_queue_t? = nil) throws -> Int {
+        return try cryptBatch(operation: .Encrypt, algorithm: alg, key: key, records: records, input: input, output: output, ranges: &ranges, recordsPerShard: recordsPerShard, queue: queue)
+    }
+    
+    /// Decrypt many independent messages under the same key, each with its
+    /// own IV.
+    ///
+    /// When decrypting with padding, a message may not fill its slot; use
+    /// the returned `ranges` to locate each result.
+    ///
+    /// - seealso: encryptBatchWithAlgorithm(algorithm:key:records:input:output:ranges:recordsPerShard:queue:)
+    static func decryptBatchWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, records: [BatchRecord], input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, inout ranges: [Range<Int>], recordsPerShard: Int = 4096, queue: dispatch_queue_t? = nil) throws -> Int {
+        return try cryptBatch(operation: .Decrypt, algorithm: alg, key: key, records: records, input: input, output: output, ranges: &ranges, recordsPerShard: recordsPerShard, queue: queue)
+    }
+    
+}
@@ -0,0 +1,173 @@
+//
+//  BufferArena.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// A cache of page-aligned buffers for cryptor output and scratch space.
+///
+/// Requests are rounded up to a size class - a power-of-two multiple of the
+/// page size - and served from that class's free list when possible, so a
+/// long-running process reuses the same few allocations rather than
+/// churning and fragmenting the heap. Requests larger than the largest
+/// class are allocated and freed directly.
+///
+/// Buffers are wiped when they are returned to the arena. At most
+/// `maximumCachedPerClass` free buffers are kept for each class; beyond that,
+/// returned buffers are freed.
+///
+/// A `BufferArena` can be used from multiple threads at the same time.
+public final class BufferArena {
+    
+    /// An arena shared by the framework's streaming and batch APIs.
+    public static let sharedArena = BufferArena()
+    
+    private static let pageSize = Int(getpagesize())
+    /// Classes are one page, two pages, four pages, and so on, up to 16 MB
+    /// with 4 KB pages.
+    private static let classCount = 13
+    
+    /// The number of free buffers kept for each size class.
+    public let maximumCachedPerClass: Int
+    
+    private let lock = Mutex()
+    private var free: [[UnsafeMutablePointer<Void>]]
+    private var outstanding = 0
+    private var peak = 0
+    
+    /// Create an empty arena.
+    ///
+    /// - parameter maximumCachedPerClass: The number of free buffers to keep
+    ///   for each size class.
+    public init(maximumCachedPerClass: Int = 8) {
+        self.maximumCachedPerClass = maximumCachedPerClass
+        self.free = [[UnsafeMutablePointer<Void>]](count: BufferArena.classCount, repeatedValue: [])
+    }
+    
+    deinit {
+        for list in free {
+            for buffer in list {
+                Darwin.free(buffer)
+            }
+        }
+    }
+    
+    /// The size class for `count` bytes, or `nil` if too large for any.
+    private static func sizeClass(count: Int) -> Int? {
+        var sizeClass = 0
+        var capacity = pageSize
+        while capacity < count && sizeClass < classCount {
+            sizeClass += 1
+            capacity *= 2
+        }
+        return sizeClass < classCount ? sizeClass : nil
+    }
+    
+    /// The bytes allocated for a request of `count` bytes, or `nil` if
+    /// rounding it up to a whole page would overflow.
+    private static func capacity(count: Int) -> Int? {
+        guard let sizeClass = sizeClass(count) else {
+            guard count <= Int.max - (pageSize - 1) else { return nil }
+            return (count + pageSize - 1) / pageSize * pageSize
+        }
+        return pageSize << sizeClass
+    }
+    
+    /// The number of bytes currently checked out of the arena.
+    public var bytesInUse: Int {
+        return lock.withLock { outstanding }
+    }
+    
+    /// The largest number of bytes checked out of the arena at once.
+    public var highWaterMark: Int {
+        return lock.withLock { peak }
+    }
+    
+    /// Check out a buffer.
+    ///
+    /// - parameter count: The minimum number of bytes needed.
+    /// - returns: A page-aligned buffer of at least `count` bytes; its
+    ///   `count` is the full capacity of its size class. Its contents are
+    ///   zero. It must be given back with `release`.
+    /// - throws:
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public func allocate(count: Int) throws -> UnsafeMutableBufferPointer<Void> {
+        guard let capacity = BufferArena.capacity(max(count, 1)) else {
+            throw CryptoError.CouldNotAllocateMemory
+        }
+        let sizeClass = BufferArena.sizeClass(capacity)
+        
+        let cached: UnsafeMutablePointer<Void>? = lock.withLock {
+            outstanding += capacity
+            peak = max(peak, outstanding)
+            guard let sizeClass = sizeClass where !free[sizeClass].isEmpty else { return nil }
+            return free[sizeClass].removeLast()
+        }
+        if let buffer = cached {
+            return UnsafeMutableBufferPointer(start: buffer, count: capacity)
+        }
+        
+        var buffer = UnsafeMutablePointer<Void>()
+        guard posix_memalign(&buffer, BufferArena.pageSize, capacity) == 0 else {
+            lock.withLock { outstanding -= capacity }
+            throw CryptoError.CouldNotAllocateMemory
+        }
+        memset(buffer, 0, capacity)
+        return UnsafeMutableBufferPointer(start: buffer, count: capacity)
+    }
+    
+    /// Give back a buffer checked out with `allocate`. Its contents are
+    /// wiped.
+    ///
+    /// - parameter buffer: The buffer exactly as returned from `allocate`.
+    public func release(buffer: UnsafeMutableBufferPointer<Void>) {
+        guard buffer.baseAddress != nil else { return }
+        secureZero(buffer.baseAddress, count: buffer.count)
+        
+        let sizeClass = BufferArena.sizeClass(buffer.count)
+        let kept: Bool = lock.withLock {
+            outstanding -= buffer.count
+            guard let sizeClass = sizeClass where free[sizeClass].count < maximumCachedPerClass else { return false }
+            free[sizeClass].append(buffer.baseAddress)
+            return true
+        }
+        if !kept {
+            Darwin.free(buffer.baseAddress)
+        }
+    }
+    
+    /// Check out a buffer for the duration of `body`.
+    ///
+    /// The buffer is released when `body` exits. It must not be retained or
+    /// used after that point.
+    ///
+    /// - seealso: allocate(_:)
+    public func withBuffer<Return>(count: Int, @noescape body: UnsafeMutableBufferPointer<Void> throws -> Return) throws -> Return {
+        let buffer = try allocate(count)
+        defer { release(buffer) }
+        return try body(buffer)
+    }
+    
+    /// Free every cached buffer. Buffers that are checked out are unaffected.
+    public func removeAll() {
+        let evicted: [[UnsafeMutablePointer<Void>]] = lock.withLock {
+            defer {
+                for index in free.indices {
+                    free[index].removeAll()
+                }
+            }
+            return free
+        }
+        for list in evicted {
+            for buffer in list {
+                Darwin.free(buffer)
+            }
+        }
+    }
+    
+}
@@ -0,0 +1,164 @@
+//
+//  ChunkSizeTuner.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+import Dispatch
+
+/// Chooses how many bytes to pass to each call to `Cryptor.update`.
+///
+/// The fastest chunk size depends on the algorithm, the mode, and whether
+/// the hardware accelerates it; too small, and per-call overhead dominates;
+/// too large, and the working set falls out of cache. The first time a
+/// chunk size is needed for an algorithm and mode, each of `candidates` is
+/// timed through a scratch cryptor, and the fastest is kept for the life of
+/// the process.
+///
+/// The winner is the default chunk size for `Cryptor.processFile`,
+/// `Cryptor.process`, `DispatchCryptor`, and `ParallelCTRCryptor`. Tuning
+/// takes a few milliseconds for AES, and longer for slow ciphers such as
+/// Triple-DES; call `tune` at startup, off the main thread, to avoid paying
+/// for it on first use. `Cryptor.process` tunes on its own queue, and
+/// `DispatchCryptor` and `ParallelCTRCryptor` never tune on the calling
+/// thread: until a winner is known, they use `fallbackChunkSize` and tune in
+/// the background.
+public enum ChunkSizeTuner {
+    
+    /// The chunk sizes tried, in bytes.
+    public static let candidates = [ 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024 ]
+    /// The chunk size used when an algorithm and mode cannot be tuned.
+    public static let fallbackChunkSize = 256 * 1024
+    
+    /// The number of bytes processed while timing each candidate.
+    private static let sampleLength = 1024 * 1024
+    private static let lock = Mutex()
+    private static var winners = [UInt64: Int]()
+    /// Configurations being tuned in the background.
+    private static var scheduled = Set<UInt64>()
+    
+    private static func identifier(algorithm alg: CCAlgorithm, mode: CCMode) -> UInt64 {
+        return UInt64(alg.rawValue) << 32 | UInt64(mode.rawValue)
+    }
+    
+    /// Time `sampleLength` bytes through `cryptor`, `chunkSize` at a time.
+    private static func measure(cryptor: Cryptor, chunkSize: Int, buffer: UnsafeMutableBufferPointer<Void>) throws -> UInt64 {
+        let bytes = UnsafeMutablePointer<UInt8>(buffer.baseAddress)
+        let start = mach_absolute_time()
+        var done = 0
+        while done < sampleLength {
+            let count = min(chunkSize, sampleLength - done)
+            var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: bytes + count, count: count + kCCBlockSizeAES128)
+            try cryptor.update(UnsafeBufferPointer(start: bytes, count: count), output: &out)
+            done += count
+        }
+        return mach_absolute_time() - start
+    }
+    
+    /// Find the fastest candidate for a configuration, or `nil` if it cannot
+    /// be timed in isolation.
+    private static func tune(algorithm alg: CCAlgorithm, mode: CCMode) -> Int? {
+        let keyLength: Int
+        switch alg {
+        case .AES: keyLength = kCCKeySizeAES128
+        case .DES: keyLength = kCCKeySizeDES
+        case .TripleDES: keyLength = kCCKeySize3DES
+        case .CAST: keyLength = kCCKeySizeMaxCAST
+        case .RC4: keyLength = kCCKeySizeMinRC4
+        case .Blowfish: keyLength = 16
+        default: return nil
+        }
+        switch mode {
+        case .ECB, .CBC, .CFB, .CTR, .OFB, .CFB8, .RC4: break
+        default: return nil
+        }
+        
+        do {
+            // Input and output each need the largest candidate, plus a block.
+            let largest = candidates.maxElement() ?? fallbackChunkSize
+            return try BufferArena.sharedArena.withBuffer(2 * largest + kCCBlockSizeAES128) { buffer in
+                let key = [UInt8](count: keyLength, repeatedValue: 0x5A)
+                let configuration = Cryptor.Configuration(mode: mode, algorithm: alg, padding: .None, iv: nil, tweak: nil, numberOfRounds: nil)
+                var cryptor: Cryptor!
+                try key.withUnsafeBufferPointer {
+                    cryptor = try Cryptor(operation: .Encrypt, configuration: configuration, key: UnsafeBufferPointer(start: $0.baseAddress, count: $0.count))
+                }
+                
+                var best: (chunkSize: Int, time: UInt64)?
+                for chunkSize in candidates {
+                    // Warm up, then keep the faster of two runs.
+                    try measure(cryptor, chunkSize: chunkSize, buffer: buffer)
+                    let time = try min(measure(cryptor, chunkSize: chunkSize, buffer: buffer), measure(cryptor, chunkSize: chunkSize, buffer: buffer))
+                    if best == nil || time < best!.time {
+                        best = (chunkSize, time)
+                    }
+                }
+                return best?.chunkSize
+            }
+        } catch {
+            return nil
+        }
+    }
+    
+    /// The tuned chunk size for a configuration, tuning it if needed.
+    static func chunkSize(algorithm alg: CCAlgorithm, mode: CCMode) -> Int {
+        let identifier = ChunkSizeTuner.identifier(algorithm: alg, mode: mode)
+        if let winner = lock.withLock({ winners[identifier] }) {
+            return winner
+        }
+        
+        // Tune outside the lock; a racing thread may tune the same
+        // configuration, with the same result.
+        let winner = tune(algorithm: alg, mode: mode) ?? fallbackChunkSize
+        lock.withLock { winners[identifier] = winner }
+        return winner
+    }
+    
+    /// The tuned chunk size for a configuration if it is already known;
+    /// otherwise, `fallbackChunkSize`, while it is tuned in the background.
+    static func cachedChunkSize(algorithm alg: CCAlgorithm, mode: CCMode) -> Int {
+        let identifier = ChunkSizeTuner.identifier(algorithm: alg, mode: mode)
+        let (winner, isScheduled): (Int?, Bool) = lock.withLock {
+            let winner = winners[identifier]
+            guard winner == nil && !scheduled.contains(identifier) else { return (winner, false) }
+            scheduled.insert(identifier)
+            return (nil, true)
+        }
+        if let winner = winner {
+            return winner
+        }
+        
+        if isScheduled {
+            dispatch_async(Cryptor.asynchronousQueue) {
+                ChunkSizeTuner.chunkSize(algorithm: alg, mode: mode)
+                ChunkSizeTuner.lock.withLock { ChunkSizeTuner.scheduled.remove(identifier) }
+            }
+        }
+        return fallbackChunkSize
+    }
+    
+    /// The tuned chunk size for an algorithm and its mode, tuning it first
+    /// if this is the first request. Padding and IV do not affect the
+    /// result.
+    public static func chunkSize(forAlgorithm algorithm: Cryptor.Algorithm) -> Int {
+        let c = Cryptor.Configuration(algorithm)
+        return chunkSize(algorithm: c.algorithm, mode: c.mode)
+    }
+    
+    /// Tune several algorithms ahead of time.
+    public static func tune(algorithms: [Cryptor.Algorithm]) {
+        for algorithm in algorithms {
+            chunkSize(forAlgorithm: algorithm)
+        }
+    }
+    
+    /// Discard all tuned chunk sizes; each will be tuned again on next use.
+    public static func removeAll() {
+        lock.withLock { winners.removeAll() }
+    }
+    
+}
@@ -0,0 +1,389 @@
+//
+//  Container.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// A framed, seekable, authenticated file format for large payloads.
+///
+/// The plaintext is split into fixed-size segments. Each segment is
+/// encrypted with AES-256 in counter mode under its own random IV, and
+/// authenticated with HMAC-SHA256 over the container's identity, the
+/// segment's index, its IV, and its ciphertext. A file is laid out as:
+///
+///     header | segment 0 | segment 1 | ... | segment n-1 | index
+///
+/// The header carries a magic number and version, the segment size, a
+/// random container identifier, and the plaintext length, followed by an
+/// HMAC of those fields. The index holds the IV and tag of each segment.
+/// Ciphertext is the same length as plaintext, so the location of every
+/// segment and index entry is computed directly from the header.
+///
+/// A `ContainerReader` decrypts only the segments overlapping a requested
+/// range, so the cost of a seek does not depend on the size of the file.
+/// Segments cannot be reordered, moved between containers, or truncated
+/// without detection.
+///
+/// The encryption and MAC keys must be independent 32-byte keys.
+private enum ContainerFormat {
+    
+    static let magic: [UInt8] = [ 0x4F, 0x54, 0x50, 0x43 ] // "OTPC"
+    static let version: UInt32 = 1
+    static let identifierLength = 16
+    /// magic, version, segment size, identifier, plaintext length.
+    static let fieldsLength = 4 + 4 + 8 + identifierLength + 8
+    static let macAlgorithm = Digest.Algorithm.SHA256
+    static let tagLength = macAlgorithm.digestLength
+    static let headerLength = fieldsLength + tagLength
+    static let ivLength = kCCBlockSizeAES128
+    static let indexEntryLength = ivLength + tagLength
+    static let keyLength = kCCKeySizeAES256
+    
+    static func appendBigEndian<Integer: UnsignedIntegerType>(value: Integer, byteCount: Int, inout to bytes: [UInt8]) {
+        let value = value.toUIntMax()
+        for shift in (0 ..< byteCount).reverse() {
+            bytes.append(UInt8(truncatingBitPattern: value >> UIntMax(shift * 8)))
+        }
+    }
+    
+    static func readBigEndian(bytes: ArraySlice<UInt8>) -> UIntMax {
+        return bytes.reduce(0) { $0 << 8 | UIntMax($1) }
+    }
+    
+    static func fields(segmentSize segmentSize: Int, identifier: [UInt8], length: Int) -> [UInt8] {
+        var fields = magic
+        fields.reserveCapacity(headerLength)
+        appendBigEndian(version, byteCount: 4, to: &fields)
+        appendBigEndian(UInt64(segmentSize), byteCount: 8, to: &fields)
+        fields.appendContentsOf(identifier)
+        appendBigEndian(UInt64(length), byteCount: 8, to: &fields)
+        return fields
+    }
+    
+    /// Authenticate one segment, writing the tag to `tag`.
+    static func authenticate(mac: HMAC, identifier: [UInt8], index: Int, iv: UnsafeBufferPointer<Void>, ciphertext: UnsafeBufferPointer<Void>, tag: UnsafeMutableBufferPointer<Void>) throws {
+        var mac = mac
+        var prefix = identifier
+        appendBigEndian(UInt64(index), byteCount: 8, to: &prefix)
+        prefix.withUnsafeBufferPointer {
+            mac.update(UnsafeBufferPointer(start: $0.baseAddress, count: $0.count))
+        }
+        mac.update(iv)
+        mac.update(ciphertext)
+        var tag = tag
+        try mac.finalize(&tag)
+    }
+    
+    static func crypt(key: SecretBytes, iv: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws {
+        var out: UnsafeMutableBufferPointer<Void>! = output
+        try Cryptor.encryptWithAlgorithm(algorithm: .AES(.CTR(iv: iv.baseAddress), .None), key: key.buffer, input: input, output: &out)
+    }
+    
+    static func validateKeys(key: UnsafeBufferPointer<Void>, macKey: UnsafeBufferPointer<Void>) throws {
+        guard key.count == keyLength && macKey.count > 0 else {
+            throw CryptoError.InvalidParameters
+        }
+    }
+    
+}
+
+private func readFully(descriptor: Int32, buffer: UnsafeMutableBufferPointer<Void>, offset: Int) throws {
+    var done = 0
+    while done < buffer.count {
+        let count = pread(descriptor, UnsafeMutablePointer<UInt8>(buffer.baseAddress) + done, buffer.count - done, off_t(offset + done))
+        guard count >= 0 else {
+            throw posixError(errno)
+        }
+        guard count > 0 else {
+            throw CryptoError.DecodingFailure
+        }
+        done += count
+    }
+}
+
+private func writeFully(descriptor: Int32, buffer: UnsafeBufferPointer<Void>, offset: Int) throws {
+    var done = 0
+    while done < buffer.count {
+        let count = pwrite(descriptor, UnsafePointer<UInt8>(buffer.baseAddress) + done, buffer.count - done, off_t(offset + done))
+        guard count >= 0 else {
+            throw posixError(errno)
+        }
+        done += count
+    }
+}
+
+/// Writes a container to a file, one segment at a time.
+///
+/// Data is buffered until a full segment is available; each segment is
+/// encrypted, authenticated, and written at its final position immediately.
+/// The index and header are written by `finish`, so a container is not
+/// readable until then.
+public final class ContainerWriter {
+    
+    /// The number of plaintext bytes in each segment.
+    public let segmentSize: Int
+    
+    private let descriptor: Int32
+    private let key: SecretBytes
+    private let mac: HMAC
+    private let identifier: [UInt8]
+    private var segment = [UInt8]()
+    private var ciphertext: [UInt8]
+    private var index = [UInt8]()
+    private var segmentCount = 0
+    private var length = 0
+    
+    /// Begin writing a container.
+    ///
+    /// - parameter descriptor: A file descriptor open for writing. The
+    ///   container is written from offset zero; the descriptor is not closed.
+    /// - parameter key: A 32-byte AES key.
+    /// - parameter macKey: HMAC key material, independent of `key`.
+    /// - parameter segmentSize: The number of plaintext bytes per segment,
+    ///   greater than zero. This is the granularity of random access.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` for invalid keys or segment size.
+    ///   - `CryptoError.RNGFailure` if the identifier could not be generated.
+    public init(descriptor: Int32, key: UnsafeBufferPointer<Void>, macKey: UnsafeBufferPointer<Void>, segmentSize: Int = 64 * 1024) throws {
+        try ContainerFormat.validateKeys(key, macKey: macKey)
+        guard segmentSize > 0 else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        self.segmentSize = segmentSize
+        self.descriptor = descriptor
+        self.key = SecretBytes(copying: key)
+        self.mac = HMAC(algorithm: ContainerFormat.macAlgorithm, key: macKey)
+        self.identifier = try [UInt8](randomCount: ContainerFormat.identifierLength)
+        self.ciphertext = [UInt8](count: segmentSize, repeatedValue: 0)
+        segment.reserveCapacity(segmentSize)
+    }
+    
+    deinit {
+        segment.secureZero()
+    }
+    
+    private func flushSegment() throws {
+        guard !segment.isEmpty else { return }
+        
+        var entry = [UInt8](count: ContainerFormat.indexEntryLength, repeatedValue: 0)
+        try entry.withUnsafeMutableBufferPointer { (inout entry: UnsafeMutableBufferPointer<UInt8>) in
+            let iv = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(entry.baseAddress), count: ContainerFormat.ivLength)
+            let tag = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(entry.baseAddress + ContainerFormat.ivLength), count: ContainerFormat.tagLength)
+            try RandomPool.fill(iv)
+            
+            try segment.withUnsafeBufferPointer { plaintext in
+                try ciphertext.withUnsafeMutableBufferPointer { (inout ciphertext: UnsafeMutableBufferPointer<UInt8>) in
+                    let input = UnsafeBufferPointer<Void>(start: plaintext.baseAddress, count: plaintext.count)
+                    let output = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(ciphertext.baseAddress), count: plaintext.count)
+                    try ContainerFormat.crypt(key, iv: UnsafeBufferPointer(iv), input: input, output: output)
+                    try ContainerFormat.authenticate(mac, identifier: identifier, index: segmentCount, iv: UnsafeBufferPointer(iv), ciphertext: UnsafeBufferPointer(output), tag: tag)
+                    try writeFully(descriptor, buffer: UnsafeBufferPointer(output), offset: ContainerFormat.headerLength + segmentCount * segmentSize)
+                }
+            }
+        }
+        
+        index.appendContentsOf(entry)
+        segmentCount += 1
+        segment.secureZero()
+        segment.removeAll(keepCapacity: true)
+    }
+    
+    /// Append plaintext to the container.
+    ///
+    /// - throws:
+    ///   - An error in `NSPOSIXErrorDomain` if the file could not be written.
+    ///   - `CryptoError.RNGFailure` if an IV could not be generated.
+    public func write(data: UnsafeBufferPointer<Void>) throws {
+        var bytes = UnsafePointer<UInt8>(data.baseAddress)
+        var remaining = data.count
+        while remaining > 0 {
+            let count = min(remaining, segmentSize - segment.count)
+            segment.appendContentsOf(UnsafeBufferPointer(start: bytes, count: count))
+            bytes += count
+            remaining -= count
+            length += count
+            
+            if segment.count == segmentSize {
+                try flushSegment()
+            }
+        }
+    }
+    
+    /// Write any partial segment, the index, and the header.
+    ///
+    /// The writer must not be used afterwards.
+    ///
+    /// - returns: The total length of the container file.
+    /// - throws:
+    ///   - An error in `NSPOSIXErrorDomain` if the file could not be written.
+    public func finish() throws -> Int {
+        try flushSegment()
+        
+        try index.withUnsafeBufferPointer {
+            try writeFully(descriptor, buffer: UnsafeBufferPointer(start: $0.baseAddress, count: $0.count), offset: ContainerFormat.headerLength + length)
+        }
+        
+        var header = ContainerFormat.fields(segmentSize: segmentSize, identifier: identifier, length: length)
+        var headerMAC = mac
+        header.withUnsafeBufferPointer {
+            headerMAC.update(UnsafeBufferPointer(start: $0.baseAddress, count: $0.count))
+        }
+        header.appendContentsOf(Repeat(count: ContainerFormat.tagLength, repeatedValue: 0))
+        try header.withUnsafeMutableBufferPointer { (inout header: UnsafeMutableBufferPointer<UInt8>) in
+            var tag = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(header.baseAddress + ContainerFormat.fieldsLength), count: ContainerFormat.tagLength)
+            try headerMAC.finalize(&tag)
+            try writeFully(descriptor, buffer: UnsafeBufferPointer(start: header.baseAddress, count: header.count), offset: 0)
+        }
+        
+        return ContainerFormat.headerLength + length + index.count
+    }
+    
+}
+
+/// Reads arbitrary byte ranges from a container.
+///
+/// Only the segments overlapping a requested range are read, authenticated,
+/// and decrypted.
+public final class ContainerReader {
+    
+    /// The number of plaintext bytes in the container.
+    public let length: Int
+    /// The number of plaintext bytes in each segment.
+    public let segmentSize: Int
+    
+    private let descriptor: Int32
+    private let key: SecretBytes
+    private let mac: HMAC
+    private let identifier: [UInt8]
+    private var entry = [UInt8](count: ContainerFormat.indexEntryLength, repeatedValue: 0)
+    private var segment: [UInt8]
+    
+    /// Open a container, verifying its header.
+    ///
+    /// - parameter descriptor: A file descriptor open for reading. The
+    ///   descriptor is not closed.
+    /// - parameter key: The 32-byte AES key the container was written with.
+    /// - parameter macKey: The HMAC key material the container was written
+    ///   with.
+    /// - throws:
+    ///   - `CryptoError.DecodingFailure` if the header is malformed or fails
+    ///     authentication, indicating a corrupt file or the wrong keys.
+    ///   - An error in `NSPOSIXErrorDomain` if the file could not be read.
+    public init(descriptor: Int32, key: UnsafeBufferPointer<Void>, macKey: UnsafeBufferPointer<Void>) throws {
+        try ContainerFormat.validateKeys(key, macKey: macKey)
+        
+        var header = [UInt8](count: ContainerFormat.headerLength, repeatedValue: 0)
+        try header.withUnsafeMutableBufferPointer { (inout header: UnsafeMutableBufferPointer<UInt8>) in
+            try readFully(descriptor, buffer: UnsafeMutableBufferPointer(start: UnsafeMutablePointer(header.baseAddress), count: header.count), offset: 0)
+        }
+        
+        guard Array(header[0 ..< 4]) == ContainerFormat.magic && ContainerFormat.readBigEndian(header[4 ..< 8]) == UIntMax(ContainerFormat.version) else {
+            throw CryptoError.DecodingFailure
+        }
+        
+        let mac = HMAC(algorithm: ContainerFormat.macAlgorithm, key: macKey)
+        var computed = [UInt8](count: ContainerFormat.tagLength, repeatedValue: 0)
+        try computed.withUnsafeMutableBufferPointer { (inout computed: UnsafeMutableBufferPointer<UInt8>) in
+            var tag = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(computed.baseAddress), count: computed.count)
+            try header.withUnsafeBufferPointer {
+                try mac.authenticate(UnsafeBufferPointer(start: $0.baseAddress, count: ContainerFormat.fieldsLength), output: &tag)
+            }
+        }
+        guard computed.constantTimeEquals(header[ContainerFormat.fieldsLength ..< ContainerFormat.headerLength]) else {
+            throw CryptoError.DecodingFailure
+        }
+        
+        let identifierStart = 16
+        let segmentSize = ContainerFormat.readBigEndian(header[8 ..< identifierStart])
+        let length = ContainerFormat.readBigEndian(header[identifierStart + ContainerFormat.identifierLength ..< ContainerFormat.fieldsLength])
+        guard segmentSize > 0 && segmentSize <= UIntMax(Int32.max) && length <= UIntMax(Int.max / 2) else {
+            throw CryptoError.DecodingFailure
+        }
+        
+        self.length = Int(length)
+        self.segmentSize = Int(segmentSize)
+        self.descriptor = descriptor
+        self.key = SecretBytes(copying: key)
+        self.mac = mac
+        self.identifier = Array(header[identifierStart ..< identifierStart + ContainerFormat.identifierLength])
+        self.segment = [UInt8](count: Int(segmentSize), repeatedValue: 0)
+    }
+    
+    deinit {
+        segment.secureZero()
+    }
+    
+    /// Read, authenticate, and decrypt segment `index` into `segment`.
+    private func loadSegment(index: Int) throws -> Int {
+        let count = min(segmentSize, length - index * segmentSize)
+        let indexOffset = ContainerFormat.headerLength + length + index * ContainerFormat.indexEntryLength
+        
+        try entry.withUnsafeMutableBufferPointer { (inout entry: UnsafeMutableBufferPointer<UInt8>) in
+            try readFully(descriptor, buffer: UnsafeMutableBufferPointer(start: UnsafeMutablePointer(entry.baseAddress), count: entry.count), offset: indexOffset)
+            let iv = UnsafeBufferPointer<Void>(start: entry.baseAddress, count: ContainerFormat.ivLength)
+            let tag = UnsafeBufferPointer<Void>(start: entry.baseAddress + ContainerFormat.ivLength, count: ContainerFormat.tagLength)
+            
+            try segment.withUnsafeMutableBufferPointer { (inout segment: UnsafeMutableBufferPointer<UInt8>) in
+                let data = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(segment.baseAddress), count: count)
+                try readFully(descriptor, buffer: data, offset: ContainerFormat.headerLength + index * segmentSize)
+                
+                var computed = [UInt8](count: ContainerFormat.tagLength, repeatedValue: 0)
+                try computed.withUnsafeMutableBufferPointer { (inout computed: UnsafeMutableBufferPointer<UInt8>) in
+                    let output = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(computed.baseAddress), count: computed.count)
+                    try ContainerFormat.authenticate(mac, identifier: identifier, index: index, iv: iv, ciphertext: UnsafeBufferPointer(data), tag: output)
+                }
+                let matches = computed.withUnsafeBufferPointer {
+                    constantTimeEquals($0.baseAddress, tag.baseAddress, count: ContainerFormat.tagLength)
+                }
+                guard matches else {
+                    throw CryptoError.DecodingFailure
+                }
+                
+                try ContainerFormat.crypt(key, iv: iv, input: UnsafeBufferPointer(data), output: data)
+            }
+        }
+        return count
+    }
+    
+    /// Decrypt a range of the plaintext.
+    ///
+    /// - parameter range: The byte range to read. It is clamped to `length`.
+    /// - parameter output: The plaintext is written here. Must be allocated
+    ///   by the caller, with space for at least `range.count` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    ///   - `CryptoError.DecodingFailure` if any segment read fails
+    ///     authentication. The contents of `output` are not valid.
+    ///   - An error in `NSPOSIXErrorDomain` if the file could not be read.
+    public func read(range: Range<Int>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let start = min(max(range.startIndex, 0), length)
+        let end = min(max(range.endIndex, start), length)
+        guard output.count >= end - start else {
+            throw CryptoError.BufferTooSmall
+        }
+        guard end > start else { return 0 }
+        
+        defer { segment.secureZero() }
+        var out = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        for index in start / segmentSize ... (end - 1) / segmentSize {
+            let segmentStart = index * segmentSize
+            let count = try loadSegment(index)
+            let from = max(start, segmentStart) - segmentStart
+            let to = min(end, segmentStart + count) - segmentStart
+            segment.withUnsafeBufferPointer {
+                out.assignFrom(UnsafeMutablePointer($0.baseAddress + from), count: to - from)
+            }
+            out += to - from
+        }
+        return end - start
+    }
+    
+}
@@ -45,8 +45,11 @@ public final class Cryptor: CCPointer {
     
     typealias RawCryptor = CCCryptorRef
     private(set) var rawPointer = RawCryptor()
+    /// The algorithm and mode this cryptor was created with.
+    let algorithm: CCAlgorithm
+    let mode: CCMode
     
-    private struct Configuration {
+    struct Configuration {
         let mode: CCMode
         let algorithm: CCAlgorithm
         let padding: CCPadding
@@ -55,13 +58,16 @@ public final class Cryptor: CCPointer {
         let numberOfRounds: Int32?
     }
     
-    private static func createCryptor(operation op: CCOperation, configuration c: Configuration, key: UnsafeBufferPointer<Void>, inout cryptor: RawCryptor) throws {
+    static func createCryptor(operation op: CCOperation, configuration c: Configuration, key: UnsafeBufferPointer<Void>, inout cryptor: RawCryptor) throws {
+        probe(.Creation)
         try call {
-            CCCryptorCreateWithMode(op, c.mode, c.algorithm, c.padding, c.iv, key.baseAddress, key.count, c.tweak?.baseAddress ?? nil, c.tweak?.count ?? 0, c.numberOfRounds ?? 0, [], &cryptor)
+            CCCryptorCreateWithMode(op, c.mode, c.algorithm, c.padding, c.iv, key.baseAddress, key.count, c.tweak?.baseAddress ?? nil, c.tweak?.count ?? 0, c.numberOfRounds ?? 0, c.options, &cryptor)
         }
     }
     
-    private init(operation op: CCOperation, configuration c: Configuration, key: UnsafeBufferPointer<Void>) throws {
+    init(operation op: CCOperation, configuration c: Configuration, key: UnsafeBufferPointer<Void>) throws {
+        algorithm = c.algorithm
+        mode = c.mode
         try Cryptor.createCryptor(operation: op, configuration: c, key: key, cryptor: &rawPointer)
     }
     
@@ -108,6 +114,7 @@ public final class Cryptor: CCPointer {
     ///     no state has been lost.
     /// - seealso: outputLengthForInputLength(_:finalizing:)
     public func update(data: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        probe(.Bytes(data.count))
         return try call {
             CCCryptorUpdate($0, data.baseAddress, data.count, output?.baseAddress ?? nil, output?.count ?? 0, $1)
         }
@@ -156,6 +163,7 @@ public final class Cryptor: CCPointer {
     ///   - `CryptoError.InvalidParameters` to indicate an invalid IV.
     ///   - `CryptoError.Unimplemented` for stream ciphers.
     public func reset(iv: UnsafePointer<Void> = nil) throws {
+        probe(.Reset)
         return try call {
             CCCryptorReset($0, iv)
         }
@@ -188,6 +196,14 @@ public final class Cryptor: CCPointer {
         return CCCryptorGetOutputLength(rawPointer, inputLength, finalizing)
     }
     
+    /// The fastest number of bytes to pass to each call to `update` for this
+    /// cryptor's algorithm and mode on the current hardware.
+    ///
+    /// - seealso: ChunkSizeTuner
+    public var preferredChunkSize: Int {
+        return ChunkSizeTuner.chunkSize(algorithm: algorithm, mode: mode)
+    }
+    
 }
 
 public extension Cryptor {
@@ -200,6 +216,14 @@ public extension Cryptor {
         case PKCS7
     }
     
+    /// The direction of an operation.
+    enum Operation {
+        /// Symmetric encryption.
+        case Encrypt
+        /// Symmetric decryption.
+        case Decrypt
+    }
+    
     enum Mode {
         /// Electronic Code Book Mode
         case ECB
@@ -287,9 +311,48 @@ public extension Cryptor.Algorithm {
         }
     }
     
+    /// Output buffer size, in bytes, required to process `inputLength` bytes
+    /// in one shot; i.e., by a single call to `update` followed by `finalize`.
+    ///
+    /// This is computed from the block size, mode, and padding, without
+    /// creating a cryptor:
+    ///  - For stream ciphers and block ciphers in a mode other than ECB or
+    ///    CBC, the output size is equal to the input size.
+    ///  - For block ciphers in ECB or CBC mode with padding disabled, the
+    ///    output size is equal to the input size.
+    ///  - For block ciphers in ECB or CBC mode with PKCS7 padding, encryption
+    ///    adds between one byte and one block of padding, rounding up to the
+    ///    next full block. Decryption needs space for the whole input; the
+    ///    padding is removed, and will be reflected in the number of bytes
+    ///    written.
+    ///
+    /// - parameter inputLength: The total length of data to process.
+    /// - parameter operation: Whether the data is being encrypted or
+    ///   decrypted.
+    func outputLength(forInput inputLength: Int, operation: Cryptor.Operation) -> Int {
+        let configuration = Cryptor.Configuration(self)
+        switch (configuration.mode, configuration.padding, operation) {
+        case (.ECB, .PKCS7, .Encrypt), (.CBC, .PKCS7, .Encrypt):
+            return (inputLength / blockSize + 1) * blockSize
+        default:
+            return inputLength
+        }
+    }
+    
 }
 
-private extension Cryptor.Padding {
+extension Cryptor.Operation {
+    
+    var rawValue: CCOperation {
+        switch self {
+        case .Encrypt: return .Encrypt
+        case .Decrypt: return .Decrypt
+        }
+    }
+    
+}
+
+extension Cryptor.Padding {
     
     var rawValue: CCPadding {
         switch self {
@@ -300,7 +363,43 @@ private extension Cryptor.Padding {
     
 }
 
-private extension Cryptor.Configuration {
+extension CCMode {
+    
+    /// Whether `CCCryptorReset` can be trusted to restart a context with a
+    /// new IV. Before OS X 10.13, it only works for CBC (and ECB, which has
+    /// no state to reset); for other modes it can succeed without resetting
+    /// the counter or feedback register, reusing keystream.
+    var isResettable: Bool {
+        return self == .ECB || self == .CBC
+    }
+    
+}
+
+extension Cryptor.Configuration {
+    
+    /// CommonCrypto counters are big-endian; this is requested explicitly so
+    /// that callers doing their own counter arithmetic can rely on it.
+    var options: CCModeOptions {
+        return mode == .CTR ? .BE : []
+    }
+    
+    /// An FNV-1a hash of the operation, configuration, and key, for cache
+    /// lookups; the IV and tweak are not included. Its running time depends
+    /// only on the key length.
+    func hash(operation op: CCOperation, key: UnsafeBufferPointer<Void>) -> Int {
+        var hash: UInt64 = 0xcbf29ce484222325
+        func mix(byte: UInt8) {
+            hash = (hash ^ UInt64(byte)) &* 0x100000001b3
+        }
+        mix(UInt8(truncatingBitPattern: op.rawValue))
+        mix(UInt8(truncatingBitPattern: mode.rawValue))
+        mix(UInt8(truncatingBitPattern: algorithm.rawValue))
+        mix(UInt8(truncatingBitPattern: padding.rawValue))
+        for byte in UnsafeBufferPointer(start: UnsafePointer<UInt8>(key.baseAddress), count: key.count) {
+            mix(byte)
+        }
+        return Int(truncatingBitPattern: hash >> 1)
+    }
     
     init(_ alg: CCAlgorithm, mode: Cryptor.Mode, padding: Cryptor.Padding) {
         let pad = padding.rawValue
@@ -376,23 +475,36 @@ public extension Cryptor {
         case BufferTooSmall(Int)
     }
     
-    private static func cryptWithAlgorithm(operation op: CCOperation, configuration c: Configuration, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+    /// Check that `output` can hold the result of a one-shot operation.
+    ///
+    /// - returns: The number of bytes required.
+    internal static func neededOutputLength(algorithm alg: Algorithm, operation op: Operation, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        let needed = alg.outputLength(forInput: input.count, operation: op)
+        guard output.count >= needed else {
+            throw OneShotError.BufferTooSmall(needed)
+        }
+        return needed
+    }
+    
+    private static func cryptWithAlgorithm(operation op: Operation, algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        let needed = try neededOutputLength(algorithm: alg, operation: op, input: input, output: output)
+        
         var cryptor = RawCryptor()
-        try createCryptor(operation: op, configuration: c, key: key, cryptor: &cryptor)
+        try createCryptor(operation: op.rawValue, configuration: Configuration(alg), key: key, cryptor: &cryptor)
         defer {
             CCCryptorRelease(cryptor)
         }
         
+        return try cryptWithCryptor(cryptor, needed: needed, input: input, output: &output)
+    }
+    
+    internal static func cryptWithCryptor(cryptor: RawCryptor, needed: Int, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
         var dataOut = output.baseAddress
         var dataOutAvailable = output.count
         var updateLen = 0
         var finalLen = 0
         
-        let needed = CCCryptorGetOutputLength(cryptor, input.count, true)
-        guard needed > output.count else {
-            throw OneShotError.BufferTooSmall(needed)
-        }
-        
+        probe(.Bytes(input.count))
         do {
             try call {
                 CCCryptorUpdate(cryptor, input.baseAddress, input.count, dataOut, dataOutAvailable, &updateLen)
@@ -431,11 +543,13 @@ public extension Cryptor {
     /// - throws: 
     ///   - A special `Cryptor.OneShotError.BufferToSmall` indicates insufficent
     ///     space in the output buffer, with the minimum size attached. The
-    ///     operation can be retried with minimal runtime penalty.
+    ///     check is made before any work is done. Use
+    ///     `Algorithm.outputLength(forInput:operation:)` to size the output
+    ///     buffer up front.
     ///   - `CryptoError.MisalignedMemory` if the number of bytes provided
     ///     is not an integral multiple of the algorithm's block size.
     static func encryptWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
-        return try cryptWithAlgorithm(operation: .Encrypt, configuration: Configuration(alg), key: key, input: input, output: &output)
+        return try cryptWithAlgorithm(operation: .Encrypt, algorithm: alg, key: key, input: input, output: &output)
     }
     
     /// Stateless, one-shot decryption.
@@ -454,13 +568,86 @@ public extension Cryptor {
     /// - throws:
     ///   - A special `Cryptor.OneShotError.BufferToSmall` indicates insufficent
     ///     space in the output buffer, with the minimum size attached. The
-    ///     operation can be retried with minimal runtime penalty.
+    ///     check is made before any work is done. Use
+    ///     `Algorithm.outputLength(forInput:operation:)` to size the output
+    ///     buffer up front.
     ///   - `CryptoError.MisalignedMemory` if the number of bytes provided
     ///     is not an integral multiple of the algorithm's block size.
     ///   - `CryptoError.DecodingFailure` Indicates improperly formatted
     ///     ciphertext or a "wrong key" error.
     static func decryptWithAlgorithm(algorithm alg: Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
-        return try cryptWithAlgorithm(operation: .Decrypt, configuration: Configuration(alg), key: key, input: input, output: &output)
+        return try cryptWithAlgorithm(operation: .Decrypt, algorithm: alg, key: key, input: input, output: &output)
+    }
+    
+}
+
+public extension Cryptor {
+    
+    private static func cryptWithAlgorithm<Key: BufferType, Input: BufferType, Output: BufferType where Key.Generator.Element == UInt8, Input.Generator.Element == UInt8, Output.Generator.Element == UInt8>(operation op: Operation, algorithm alg: Algorithm, key: Key, input: Input, inout output: Output) throws {
+        let available: Int = numericCast(output.count)
+        let needed = alg.outputLength(forInput: numericCast(input.count), operation: op)
+        if available < needed {
+            output.appendContentsOf(Repeat(count: needed - available, repeatedValue: 0))
+        }
+        
+        var written = 0
+        do {
+            try key.withUnsafeBufferPointer { key in
+                try input.withUnsafeBufferPointer { input in
+                    try output.withUnsafeMutableBufferPointer { buffer in
+                        var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: buffer.baseAddress, count: buffer.count)
+                        written = try cryptWithAlgorithm(operation: op, algorithm: alg, key: UnsafeBufferPointer(start: key.baseAddress, count: key.count), input: UnsafeBufferPointer(start: input.baseAddress, count: input.count), output: &out)
+                    }
+                }
+            }
+        } catch {
+            output.removeAll(keepCapacity: true)
+            throw error
+        }
+        
+        output.removeRange(output.startIndex.advancedBy(numericCast(written)) ..< output.endIndex)
+    }
+    
+    /// Stateless, one-shot encryption into existing storage.
+    ///
+    /// The contents of `output` are replaced with the ciphertext. If its
+    /// capacity is sufficient, no memory is allocated; passing the same
+    /// `output` for many messages reuses its storage.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - parameter input: Data to encrypt.
+    /// - parameter output: The result is written here. It is grown to fit
+    ///   if needed, then trimmed to the number of bytes written. If an error
+    ///   is thrown, it is emptied.
+    /// - throws:
+    ///   - `CryptoError.MisalignedMemory` if the number of bytes provided
+    ///     is not an integral multiple of the algorithm's block size.
+    static func encryptWithAlgorithm<Key: BufferType, Input: BufferType, Output: BufferType where Key.Generator.Element == UInt8, Input.Generator.Element == UInt8, Output.Generator.Element == UInt8>(algorithm alg: Algorithm, key: Key, input: Input, inout output: Output) throws {
+        try cryptWithAlgorithm(operation: .Encrypt, algorithm: alg, key: key, input: input, output: &output)
+    }
+    
+    /// Stateless, one-shot decryption into existing storage.
+    ///
+    /// The contents of `output` are replaced with the plaintext. If its
+    /// capacity is sufficient, no memory is allocated; passing the same
+    /// `output` for many messages reuses its storage.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - parameter input: Data to decrypt.
+    /// - parameter output: The result is written here. It is grown to fit
+    ///   if needed, then trimmed to the number of bytes written. If an error
+    ///   is thrown, it is emptied.
+    /// - throws:
+    ///   - `CryptoError.MisalignedMemory` if the number of bytes provided
+    ///     is not an integral multiple of the algorithm's block size.
+    ///   - `CryptoError.DecodingFailure` Indicates improperly formatted
+    ///     ciphertext or a "wrong key" error.
+    static func decryptWithAlgorithm<Key: BufferType, Input: BufferType, Output: BufferType where Key.Generator.Element == UInt8, Input.Generator.Element == UInt8, Output.Generator.Element == UInt8>(algorithm alg: Algorithm, key: Key, input: Input, inout output: Output) throws {
+        try cryptWithAlgorithm(operation: .Decrypt, algorithm: alg, key: key, input: input, output: &output)
     }
     
 }
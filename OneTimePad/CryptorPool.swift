@@ -0,0 +1,391 @@
+//
+//  CryptorPool.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// A thread-safe cache of ready-to-use `Cryptor` instances.
+///
+/// Creating a cryptor performs key expansion and allocates memory inside
+/// CommonCrypto, which dominates the cost of processing small payloads. A pool
+/// keeps cryptors that are not in use, keyed by their operation, algorithm,
+/// mode, padding, and raw key material. A pooled cryptor is handed out again
+/// after a call to `reset` with the IV of the new request, which is much
+/// cheaper than creating a new one.
+///
+/// Idle cryptors are kept in three tiers, checked in order:
+///  - Each thread keeps up to `threadCapacity` of the cryptors it most
+///    recently used. These are taken and returned without any
+///    synchronization.
+///  - A set of lock-free stacks, each holding up to `bucketCapacity`
+///    cryptors, indexed by a hash of the configuration and key. Threads
+///    contending on the same few keys take and return cryptors here with a
+///    single atomic operation.
+///  - A list of at most `capacity` cryptors, guarded by a lock; beyond that,
+///    the least recently used are released.
+///
+/// A pool retains a copy of the key material for each idle cryptor, which is
+/// wiped when the cryptor is released. The cryptors cached by a thread are
+/// moved to the shared tiers when that thread exits, and are otherwise only
+/// released with the pool, or by that thread calling `removeAll`.
+///
+/// Only ECB and CBC cryptors are pooled. Stream ciphers (i.e., RC4) cannot
+/// be reset, and on the deployment target, resetting other modes can
+/// silently leave their counter or feedback register unchanged.
+public final class CryptorPool {
+    
+    private final class Entry {
+        let operation: CCOperation
+        let mode: CCMode
+        let algorithm: CCAlgorithm
+        let padding: CCPadding
+        let numberOfRounds: Int32
+        let key: SecretBytes
+        let tweak: SecretBytes?
+        let cryptor: Cryptor
+        
+        init(operation op: CCOperation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>) throws {
+            operation = op
+            mode = c.mode
+            algorithm = c.algorithm
+            padding = c.padding
+            numberOfRounds = c.numberOfRounds ?? 0
+            self.key = SecretBytes(copying: key)
+            tweak = c.tweak.map { SecretBytes(copying: $0) }
+            cryptor = try Cryptor(operation: op, configuration: c, key: key)
+        }
+        
+        var isReusable: Bool {
+            return mode.isResettable
+        }
+        
+        var bucketHash: Int {
+            let c = Cryptor.Configuration(mode: mode, algorithm: algorithm, padding: padding, iv: nil, tweak: tweak?.buffer, numberOfRounds: numberOfRounds)
+            return c.hash(operation: operation, key: key.buffer)
+        }
+        
+        func matches(operation op: CCOperation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>) -> Bool {
+            guard op == operation && c.mode == mode && c.algorithm == algorithm && c.padding == padding && (c.numberOfRounds ?? 0) == numberOfRounds else { return false }
+            switch (c.tweak, tweak) {
+            case (.None, .None):
+                break
+            case let (.Some(lhs), .Some(rhs)) where rhs.matches(lhs):
+                break
+            default:
+                return false
+            }
+            return self.key.matches(key)
+        }
+    }
+    
+    /// The idle cryptors of one thread for one pool.
+    ///
+    /// Its entries are only touched by the owning thread while the pool is
+    /// alive, by that thread's exit if the pool is still alive, or by
+    /// the pool as it is destroyed, after which no thread touches them again.
+    private final class ThreadCache {
+        /// The owning pool, to hand the entries back to when the thread exits.
+        weak var pool: CryptorPool?
+        /// From least to most recently used.
+        var entries = [Entry]()
+        
+        init(pool: CryptorPool) {
+            self.pool = pool
+        }
+    }
+    
+    /// Every pool's cache for one thread, owned by its thread-specific value
+    /// and released when the thread exits.
+    private final class ThreadCaches {
+        var caches = [ThreadCache]()
+    }
+    
+    /// One key for all pools, so a process cannot run out of keys by
+    /// creating pools; `nil` if none was available, which disables the
+    /// per-thread tier.
+    private static let threadKey: pthread_key_t? = {
+        var key = pthread_key_t()
+        let status = pthread_key_create(&key) { value in
+            // Balances the retain taken by `threadCache`. Pools that are
+            // already gone have released the entries themselves.
+            let caches = Unmanaged<ThreadCaches>.fromOpaque(COpaquePointer(value)).takeRetainedValue()
+            for cache in caches.caches {
+                cache.pool?.threadDidExit(cache)
+            }
+        }
+        return status == 0 ? key : nil
+    }()
+    
+    /// A link in a lock-free bucket, owning a retain of its entry.
+    private struct Node {
+        var next: UnsafeMutablePointer<Node>
+        var entry: Unmanaged<Entry>
+    }
+    
+    private static let bucketCount = 64
+    
+    /// The maximum number of idle cryptors retained under the lock.
+    public let capacity: Int
+    /// The maximum number of idle cryptors retained by each thread.
+    public let threadCapacity: Int
+    /// The maximum number of idle cryptors in each lock-free bucket.
+    public let bucketCapacity: Int
+    
+    private let lock = Mutex()
+    /// Idle cryptors, from least to most recently used.
+    private var idle = [Entry]()
+    /// Every live thread's cache, so that their entries are released with
+    /// the pool.
+    private var threadCaches = [ThreadCache]()
+    private let buckets = UnsafeMutablePointer<OSQueueHead>.alloc(CryptorPool.bucketCount)
+    private let bucketCounts = UnsafeMutablePointer<Int32>.alloc(CryptorPool.bucketCount)
+    
+    /// Create an empty pool.
+    ///
+    /// - parameter capacity: The maximum number of idle cryptors to retain
+    ///   under the lock.
+    /// - parameter threadCapacity: The maximum number of idle cryptors to
+    ///   retain for each thread.
+    /// - parameter bucketCapacity: The maximum number of idle cryptors to
+    ///   retain in each lock-free bucket.
+    public init(capacity: Int = 16, threadCapacity: Int = 4, bucketCapacity: Int = 4) {
+        self.capacity = capacity
+        self.threadCapacity = threadCapacity
+        self.bucketCapacity = bucketCapacity
+        idle.reserveCapacity(capacity + 1)
+        buckets.initializeFrom(Repeat(count: CryptorPool.bucketCount, repeatedValue: OSQueueHead(opaque1: nil, opaque2: 0)))
+        bucketCounts.initializeFrom(Repeat(count: CryptorPool.bucketCount, repeatedValue: 0))
+    }
+    
+    deinit {
+        // Threads still running keep the (now empty) cache shell until they
+        // next use any pool, or exit; its pool reference is already nil, so
+        // they never touch the entries.
+        for cache in threadCaches {
+            cache.entries.removeAll()
+        }
+        for index in 0 ..< CryptorPool.bucketCount {
+            while let entry = dequeue(fromBucket: index) {
+                withExtendedLifetime(entry) {}
+            }
+        }
+        buckets.dealloc(CryptorPool.bucketCount)
+        bucketCounts.dealloc(CryptorPool.bucketCount)
+    }
+    
+    /// The calling thread's cache, created on first use, or `nil` if the
+    /// per-thread tier is unavailable.
+    private var threadCache: ThreadCache? {
+        guard let key = CryptorPool.threadKey else { return nil }
+        
+        let caches: ThreadCaches
+        let existing = pthread_getspecific(key)
+        if existing != nil {
+            caches = Unmanaged<ThreadCaches>.fromOpaque(COpaquePointer(existing)).takeUnretainedValue()
+            for cache in caches.caches where cache.pool === self {
+                return cache
+            }
+            // Drop the shells left by pools that are gone.
+            caches.caches = caches.caches.filter { $0.pool != nil }
+        } else {
+            caches = ThreadCaches()
+            let retained = Unmanaged.passRetained(caches)
+            guard pthread_setspecific(key, UnsafePointer(retained.toOpaque())) == 0 else {
+                retained.release()
+                return nil
+            }
+        }
+        
+        // Both the pool and the thread-specific value hold a reference, so
+        // the cache outlives whichever goes first.
+        let cache = ThreadCache(pool: self)
+        lock.withLock { threadCaches.append(cache) }
+        caches.caches.append(cache)
+        return cache
+    }
+    
+    /// Move the idle cryptors of an exiting thread to the shared tiers.
+    private func threadDidExit(cache: ThreadCache) {
+        lock.withLock {
+            if let index = threadCaches.indexOf({ $0 === cache }) {
+                threadCaches.removeAtIndex(index)
+            }
+        }
+        let entries = cache.entries
+        cache.entries.removeAll()
+        for entry in entries {
+            checkInShared(entry)
+        }
+    }
+    
+    private func bucketIndex(hash: Int) -> Int {
+        return hash % CryptorPool.bucketCount
+    }
+    
+    private func dequeue(fromBucket index: Int) -> Entry? {
+        let node = UnsafeMutablePointer<Node>(OSAtomicDequeue(buckets + index, 0))
+        guard node != nil else { return nil }
+        OSAtomicDecrement32(bucketCounts + index)
+        let entry = node.memory.entry.takeRetainedValue()
+        node.destroy()
+        node.dealloc(1)
+        return entry
+    }
+    
+    /// Push `entry` onto its bucket, unless the bucket is full.
+    private func enqueue(entry: Entry) -> Bool {
+        let index = bucketIndex(entry.bucketHash)
+        guard OSAtomicIncrement32(bucketCounts + index) <= Int32(bucketCapacity) else {
+            OSAtomicDecrement32(bucketCounts + index)
+            return false
+        }
+        let node = UnsafeMutablePointer<Node>.alloc(1)
+        node.initialize(Node(next: nil, entry: Unmanaged.passRetained(entry)))
+        OSAtomicEnqueue(buckets + index, node, 0)
+        return true
+    }
+    
+    private func findIdle(operation op: CCOperation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>) -> Entry? {
+        if let cache = threadCache, index = cache.entries.indexOf({ $0.matches(operation: op, configuration: c, key: key) }) {
+            return cache.entries.removeAtIndex(index)
+        }
+        
+        if let entry = dequeue(fromBucket: bucketIndex(c.hash(operation: op, key: key))) {
+            if entry.matches(operation: op, configuration: c, key: key) {
+                return entry
+            }
+            // A different configuration sharing the bucket; keep it warm.
+            checkInShared(entry)
+        }
+        
+        return lock.withLock {
+            guard let index = idle.indexOf({ $0.matches(operation: op, configuration: c, key: key) }) else { return nil }
+            return idle.removeAtIndex(index)
+        }
+    }
+    
+    private func checkOut(operation op: CCOperation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>) throws -> Entry {
+        if c.mode.isResettable, let entry = findIdle(operation: op, configuration: c, key: key) {
+            do {
+                try entry.cryptor.reset(c.iv)
+                return entry
+            } catch {
+                // Fall through to creating a fresh cryptor.
+            }
+        }
+        
+        return try Entry(operation: op, configuration: c, key: key)
+    }
+    
+    private func checkInShared(entry: Entry) {
+        guard !enqueue(entry) else { return }
+        let evicted: Entry? = lock.withLock {
+            idle.append(entry)
+            return idle.count > capacity ? idle.removeFirst() : nil
+        }
+        // Release any evicted cryptor outside the lock.
+        withExtendedLifetime(evicted) {}
+    }
+    
+    private func checkIn(entry: Entry) {
+        guard entry.isReusable else { return }
+        
+        guard let cache = threadCache else {
+            checkInShared(entry)
+            return
+        }
+        cache.entries.append(entry)
+        guard cache.entries.count > threadCapacity else { return }
+        checkInShared(cache.entries.removeFirst())
+    }
+    
+    private func withCryptor<Return>(operation op: CCOperation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>, @noescape body: Cryptor throws -> Return) throws -> Return {
+        let entry = try checkOut(operation: op, configuration: c, key: key)
+        defer { checkIn(entry) }
+        return try body(entry.cryptor)
+    }
+    
+    /// Release all idle cryptors held by the pool, other than those cached
+    /// by other threads.
+    public func removeAll() {
+        var evicted: [Entry] = lock.withLock {
+            defer { idle.removeAll(keepCapacity: true) }
+            return idle
+        }
+        for index in 0 ..< CryptorPool.bucketCount {
+            while let entry = dequeue(fromBucket: index) {
+                evicted.append(entry)
+            }
+        }
+        
+        if let cache = threadCache {
+            evicted.appendContentsOf(cache.entries)
+            cache.entries.removeAll(keepCapacity: true)
+        }
+        withExtendedLifetime(evicted) {}
+    }
+    
+}
+
+public extension CryptorPool {
+    
+    /// Borrow a context for encryption from the pool for the duration of
+    /// `body`.
+    ///
+    /// The cryptor is returned to the pool when `body` exits. It must not be
+    /// retained or used after that point.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    ///   - Any error thrown by `body`.
+    func withCryptor<Return>(forEncryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, @noescape body: Cryptor throws -> Return) throws -> Return {
+        return try withCryptor(operation: .Encrypt, configuration: Cryptor.Configuration(algorithm), key: key, body: body)
+    }
+    
+    /// Borrow a context for decryption from the pool for the duration of
+    /// `body`.
+    ///
+    /// The cryptor is returned to the pool when `body` exits. It must not be
+    /// retained or used after that point.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    ///   - Any error thrown by `body`.
+    func withCryptor<Return>(forDecryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, @noescape body: Cryptor throws -> Return) throws -> Return {
+        return try withCryptor(operation: .Decrypt, configuration: Cryptor.Configuration(algorithm), key: key, body: body)
+    }
+    
+    /// One-shot encryption using a pooled cryptor.
+    ///
+    /// - seealso: Cryptor.encryptWithAlgorithm(algorithm:key:input:output:)
+    func encryptWithAlgorithm(algorithm alg: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        let needed = try Cryptor.neededOutputLength(algorithm: alg, operation: .Encrypt, input: input, output: output)
+        return try withCryptor(forEncryption: alg, key: key) {
+            try Cryptor.cryptWithCryptor($0.rawPointer, needed: needed, input: input, output: &output)
+        }
+    }
+    
+    /// One-shot decryption using a pooled cryptor.
+    ///
+    /// - seealso: Cryptor.decryptWithAlgorithm(algorithm:key:input:output:)
+    func decryptWithAlgorithm(algorithm alg: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        let needed = try Cryptor.neededOutputLength(algorithm: alg, operation: .Decrypt, input: input, output: output)
+        return try withCryptor(forDecryption: alg, key: key) {
+            try Cryptor.cryptWithCryptor($0.rawPointer, needed: needed, input: input, output: &output)
+        }
+    }
+    
+}
@@ -0,0 +1,154 @@
+//
+//  CryptorSequence.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// Holds the first error encountered while iterating a `CryptorSequence`,
+/// since a generator cannot throw.
+private final class CryptorSequenceFailure {
+    var error: ErrorType?
+}
+
+/// A lazy sequence that encrypts or decrypts chunks of bytes on demand.
+///
+/// Each chunk drawn from the base sequence is passed to `Cryptor.update` as
+/// it is requested, and the result, if any, is yielded; when the base is
+/// exhausted, the `Cryptor` is finalized and any remaining output yielded.
+/// Chunks that produce no output, such as partial blocks buffered by a
+/// block cipher, are skipped.
+///
+/// The output is written into one array that is yielded for each chunk. If
+/// the consumer has let go of the previous chunk by the time the next is
+/// requested, its storage is reused; otherwise, copy-on-write gives the
+/// consumer its own. Either way, the whole stream is never held in memory.
+///
+/// A `CryptorSequence` drives a single `Cryptor`, so it can only be iterated
+/// once. Iteration stops at the first error, which is then available from
+/// `error`.
+public struct CryptorSequence<Base: SequenceType where Base.Generator.Element: BufferType, Base.Generator.Element.Generator.Element == UInt8>: LazySequenceType {
+    
+    private let base: Base
+    private let cryptor: Cryptor
+    private let failure = CryptorSequenceFailure()
+    
+    /// Create a sequence processing `base` with `cryptor`.
+    ///
+    /// - parameter cryptor: The cryptor to process data with. It should be
+    ///   freshly created or `reset`, and not used elsewhere while iterating.
+    public init(_ base: Base, cryptor: Cryptor) {
+        self.base = base
+        self.cryptor = cryptor
+    }
+    
+    /// The error that stopped iteration, if any.
+    public var error: ErrorType? {
+        return failure.error
+    }
+    
+    public func generate() -> CryptorGenerator<Base.Generator> {
+        return CryptorGenerator(base: base.generate(), cryptor: cryptor, failure: failure)
+    }
+    
+}
+
+/// A generator for `CryptorSequence`.
+public struct CryptorGenerator<Base: GeneratorType where Base.Element: BufferType, Base.Element.Generator.Element == UInt8>: GeneratorType {
+    
+    private var base: Base
+    private let cryptor: Cryptor
+    private let failure: CryptorSequenceFailure
+    private var buffer = [UInt8]()
+    private var isFinished = false
+    
+    private init(base: Base, cryptor: Cryptor, failure: CryptorSequenceFailure) {
+        self.base = base
+        self.cryptor = cryptor
+        self.failure = failure
+    }
+    
+    /// Run `body` over an output buffer of `capacity` bytes, trimmed to the
+    /// number of bytes it produces.
+    private mutating func produce(capacity: Int, @noescape body: UnsafeMutableBufferPointer<Void> throws -> Int) throws -> [UInt8]? {
+        // Keeps the storage if the consumer released the last chunk.
+        buffer.removeAll(keepCapacity: true)
+        buffer.appendContentsOf(Repeat(count: capacity, repeatedValue: 0))
+        
+        var produced = 0
+        try buffer.withUnsafeMutableBufferPointer { (inout buffer: UnsafeMutableBufferPointer<UInt8>) in
+            produced = try body(UnsafeMutableBufferPointer(start: buffer.baseAddress, count: buffer.count))
+        }
+        buffer.removeRange(produced ..< capacity)
+        return produced > 0 ? buffer : nil
+    }
+    
+    public mutating func next() -> [UInt8]? {
+        guard !isFinished else { return nil }
+        
+        do {
+            while let chunk = base.next() {
+                let capacity = cryptor.outputLengthForInputLength(numericCast(chunk.count))
+                let cryptor = self.cryptor
+                let output = try produce(capacity) { output in
+                    var out: UnsafeMutableBufferPointer<Void>! = output
+                    var produced = 0
+                    try chunk.withUnsafeBufferPointer { data in
+                        produced = try cryptor.update(UnsafeBufferPointer(start: data.baseAddress, count: data.count), output: &out)
+                    }
+                    return produced
+                }
+                if output != nil {
+                    return output
+                }
+            }
+            
+            isFinished = true
+            let capacity = cryptor.outputLengthForInputLength(0, finalizing: true)
+            let cryptor = self.cryptor
+            return try produce(capacity) { output in
+                var out = output
+                return try cryptor.finalize(&out)
+            }
+        } catch {
+            isFinished = true
+            failure.error = error
+            buffer.secureZero()
+            return nil
+        }
+    }
+    
+}
+
+public extension LazySequenceType where Elements.Generator.Element: BufferType, Elements.Generator.Element.Generator.Element == UInt8 {
+    
+    /// Lazily process each chunk with `cryptor`.
+    ///
+    /// - seealso: CryptorSequence
+    func crypt(cryptor: Cryptor) -> CryptorSequence<Elements> {
+        return CryptorSequence(elements, cryptor: cryptor)
+    }
+    
+    /// Lazily encrypt each chunk.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    func encrypt(algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>) throws -> CryptorSequence<Elements> {
+        return crypt(try Cryptor(forEncryption: algorithm, key: key))
+    }
+    
+    /// Lazily decrypt each chunk.
+    ///
+    /// - seealso: encrypt(_:key:)
+    func decrypt(algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>) throws -> CryptorSequence<Elements> {
+        return crypt(try Cryptor(forDecryption: algorithm, key: key))
+    }
+    
+}
@@ -0,0 +1,229 @@
+//
+//  Digest.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// This interface provides access to the message digest (cryptographic hash)
+/// algorithms in CommonCrypto.
+///
+/// The general operation of a digest is:
+///  - Initialize it with the algorithm to use
+///  - Process input data via one or more calls to the `update` method. Data is
+///    hashed directly from the caller's memory; nothing is copied.
+///  - Obtain the digest with the `finalize` method, which is written to
+///    caller-supplied memory. The `Digest` is then ready to be used again.
+///
+/// A `Digest` keeps its hashing state inline rather than on the heap;
+/// creating one does not allocate. As a value type, a copy of a `Digest`
+/// carries the state hashed so far - hashing a common prefix once and copying
+/// the result is a valid way to hash several messages.
+public struct Digest {
+    
+    /// The SHA-512 state is the largest of the supported algorithms; every
+    /// other state fits within its size and alignment.
+    private typealias Context = CC_SHA512_CTX
+    
+    /// The algorithm being used.
+    public let algorithm: Algorithm
+    private var context = Context()
+    
+    /// Create a context for hashing data.
+    ///
+    /// - parameter algorithm: Defines the digest algorithm to use.
+    public init(algorithm: Algorithm) {
+        self.algorithm = algorithm
+        reset()
+    }
+    
+    private mutating func withContext<Return>(@noescape body: UnsafeMutablePointer<Void> -> Return) -> Return {
+        return withUnsafeMutablePointer(&context) {
+            body(UnsafeMutablePointer($0))
+        }
+    }
+    
+    /// Reinitialize an existing `Digest`, discarding any data hashed so far.
+    public mutating func reset() {
+        let algorithm = self.algorithm
+        withContext { ctx in
+            switch algorithm {
+            case .MD5:    CC_MD5_Init(UnsafeMutablePointer(ctx))
+            case .SHA1:   CC_SHA1_Init(UnsafeMutablePointer(ctx))
+            case .SHA224: CC_SHA224_Init(UnsafeMutablePointer(ctx))
+            case .SHA256: CC_SHA256_Init(UnsafeMutablePointer(ctx))
+            case .SHA384: CC_SHA384_Init(UnsafeMutablePointer(ctx))
+            case .SHA512: CC_SHA512_Init(UnsafeMutablePointer(ctx))
+            }
+        }
+    }
+    
+    /// Process some data.
+    ///
+    /// This method can be called multiple times. The caller does not need to
+    /// align the size of input data to the algorithm's block size. Inputs
+    /// larger than 4 GB are processed in several passes.
+    ///
+    /// - parameter data: Data to process.
+    public mutating func update(data: UnsafeBufferPointer<Void>) {
+        let algorithm = self.algorithm
+        var bytes = UnsafePointer<UInt8>(data.baseAddress)
+        var remaining = data.count
+        while remaining > 0 {
+            let length = CC_LONG(truncatingBitPattern: min(remaining, Int(CC_LONG.max)))
+            withContext { ctx in
+                switch algorithm {
+                case .MD5:    CC_MD5_Update(UnsafeMutablePointer(ctx), bytes, length)
+                case .SHA1:   CC_SHA1_Update(UnsafeMutablePointer(ctx), bytes, length)
+                case .SHA224: CC_SHA224_Update(UnsafeMutablePointer(ctx), bytes, length)
+                case .SHA256: CC_SHA256_Update(UnsafeMutablePointer(ctx), bytes, length)
+                case .SHA384: CC_SHA384_Update(UnsafeMutablePointer(ctx), bytes, length)
+                case .SHA512: CC_SHA512_Update(UnsafeMutablePointer(ctx), bytes, length)
+                }
+            }
+            bytes += Int(length)
+            remaining -= Int(length)
+        }
+    }
+    
+    /// Obtain the final digest of all data provided to `update`.
+    ///
+    /// Upon successful return, the `Digest` is reset and may be used to hash
+    /// a new message.
+    ///
+    /// - parameter output: The digest is written here. Must be allocated by
+    ///   the caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No state has been lost.
+    public mutating func finalize(inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let algorithm = self.algorithm
+        let length = algorithm.digestLength
+        guard output.count >= length else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let md = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        withContext { ctx in
+            switch algorithm {
+            case .MD5:    CC_MD5_Final(md, UnsafeMutablePointer(ctx))
+            case .SHA1:   CC_SHA1_Final(md, UnsafeMutablePointer(ctx))
+            case .SHA224: CC_SHA224_Final(md, UnsafeMutablePointer(ctx))
+            case .SHA256: CC_SHA256_Final(md, UnsafeMutablePointer(ctx))
+            case .SHA384: CC_SHA384_Final(md, UnsafeMutablePointer(ctx))
+            case .SHA512: CC_SHA512_Final(md, UnsafeMutablePointer(ctx))
+            }
+        }
+        reset()
+        return length
+    }
+    
+}
+
+public extension Digest {
+    
+    enum Algorithm {
+        /// Message Digest 5, 128-bit digest.
+        ///
+        /// - warning: MD5 is broken; provided only for legacy formats.
+        case MD5
+        /// Secure Hash Algorithm 1, 160-bit digest
+        case SHA1
+        /// SHA-2, 224-bit digest
+        case SHA224
+        /// SHA-2, 256-bit digest
+        case SHA256
+        /// SHA-2, 384-bit digest
+        case SHA384
+        /// SHA-2, 512-bit digest
+        case SHA512
+    }
+    
+}
+
+public extension Digest.Algorithm {
+    
+    /// Digest size, in bytes, for supported algorithms.
+    var digestLength: Int {
+        switch self {
+        case .MD5:
+            return CC_MD5_DIGEST_LENGTH
+        case .SHA1:
+            return CC_SHA1_DIGEST_LENGTH
+        case .SHA224:
+            return CC_SHA224_DIGEST_LENGTH
+        case .SHA256:
+            return CC_SHA256_DIGEST_LENGTH
+        case .SHA384:
+            return CC_SHA384_DIGEST_LENGTH
+        case .SHA512:
+            return CC_SHA512_DIGEST_LENGTH
+        }
+    }
+    
+    /// Internal block size, in bytes, for supported algorithms.
+    var blockSize: Int {
+        switch self {
+        case .MD5:
+            return CC_MD5_BLOCK_BYTES
+        case .SHA1:
+            return CC_SHA1_BLOCK_BYTES
+        case .SHA224:
+            return CC_SHA224_BLOCK_BYTES
+        case .SHA256:
+            return CC_SHA256_BLOCK_BYTES
+        case .SHA384:
+            return CC_SHA384_BLOCK_BYTES
+        case .SHA512:
+            return CC_SHA512_BLOCK_BYTES
+        }
+    }
+    
+}
+
+public extension Digest {
+    
+    /// Stateless, one-shot digest.
+    ///
+    /// For inputs under 4 GB, this is a single call into CommonCrypto;
+    /// otherwise it performs a sequence of `Digest.init()`, `update`, and
+    /// `finalize`.
+    ///
+    /// - parameter algorithm: Defines the digest algorithm to use.
+    /// - parameter data: Data to hash.
+    /// - parameter output: The digest is written here. Must be allocated by
+    ///   the caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    static func digestWithAlgorithm(algorithm alg: Algorithm, data: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard data.count <= Int(CC_LONG.max) else {
+            var digest = Digest(algorithm: alg)
+            digest.update(data)
+            return try digest.finalize(&output)
+        }
+        
+        let length = alg.digestLength
+        guard output.count >= length else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let len = CC_LONG(truncatingBitPattern: data.count)
+        let md = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        switch alg {
+        case .MD5:    CC_MD5(data.baseAddress, len, md)
+        case .SHA1:   CC_SHA1(data.baseAddress, len, md)
+        case .SHA224: CC_SHA224(data.baseAddress, len, md)
+        case .SHA256: CC_SHA256(data.baseAddress, len, md)
+        case .SHA384: CC_SHA384(data.baseAddress, len, md)
+        case .SHA512: CC_SHA512(data.baseAddress, len, md)
+        }
+        return length
+    }
+    
+}
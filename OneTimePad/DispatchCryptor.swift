@@ -0,0 +1,232 @@
+//
+//  DispatchCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+
+/// A streaming stage that pipes data from one `dispatch_io` channel through
+/// a `Cryptor` and into another.
+///
+/// Regions read from the input channel are passed directly to `update`
+/// without being coalesced. Output is produced into one of two rotating
+/// buffers, which are handed to the output channel without copying. While one
+/// buffer is being written, the next read can be processed into the other,
+/// so reading, processing, and writing overlap rather than alternate.
+///
+/// When the input channel reaches the end of the file, the `Cryptor` is
+/// finalized and any remaining output is written.
+///
+/// The output buffers are checked out of a `BufferArena` for the duration of
+/// each stream, and are wiped when they are returned.
+///
+/// A `DispatchCryptor` processes one stream at a time.
+public final class DispatchCryptor {
+    
+    /// The cryptor used to process data.
+    public let cryptor: Cryptor
+    /// The size of each output buffer.
+    public let bufferSize: Int
+    /// The arena from which output buffers are drawn.
+    public let arena: BufferArena
+    
+    private let queue = dispatch_queue_create("me.waldowski.OneTimePad.DispatchCryptor", DISPATCH_QUEUE_SERIAL)
+    private let writeQueue = dispatch_queue_create("me.waldowski.OneTimePad.DispatchCryptor.write", DISPATCH_QUEUE_SERIAL)
+    private let available: dispatch_semaphore_t
+    private let lock = Mutex()
+    private var buffers = [UnsafeMutableBufferPointer<Void>]()
+    private var free = [UnsafeMutablePointer<UInt8>]()
+    private var failure: ErrorType?
+    private var writeOffset: off_t = 0
+    
+    /// Create a streaming stage.
+    ///
+    /// - parameter cryptor: The cryptor to process data with. It should be
+    ///   freshly created or `reset`, and not used elsewhere while streaming.
+    /// - parameter bufferSize: The size of each of the two output buffers. If
+    ///   `nil`, it is sized for the cryptor's tuned chunk size if already
+    ///   known, or else `ChunkSizeTuner.fallbackChunkSize`; tuning never
+    ///   blocks the caller.
+    /// - parameter arena: The arena from which to draw output buffers.
+    public init(cryptor: Cryptor, bufferSize: Int? = nil, arena: BufferArena = BufferArena.sharedArena) {
+        self.cryptor = cryptor
+        // Output for an update can exceed its input by up to one block.
+        self.bufferSize = max(bufferSize ?? ChunkSizeTuner.cachedChunkSize(algorithm: cryptor.algorithm, mode: cryptor.mode) + kCCBlockSizeAES128, 2 * kCCBlockSizeAES128)
+        self.arena = arena
+        self.available = dispatch_semaphore_create(2)
+    }
+    
+    private func checkOutBuffers() throws {
+        buffers.removeAll(keepCapacity: true)
+        do {
+            for _ in 0 ..< 2 {
+                buffers.append(try arena.allocate(bufferSize))
+            }
+        } catch {
+            checkInBuffers()
+            throw error
+        }
+        free = buffers.map { UnsafeMutablePointer($0.baseAddress) }
+    }
+    
+    private func checkInBuffers() {
+        // Wait for the output channel to let go of every buffer.
+        for _ in buffers {
+            dispatch_semaphore_wait(available, DISPATCH_TIME_FOREVER)
+        }
+        for buffer in buffers {
+            arena.release(buffer)
+            dispatch_semaphore_signal(available)
+        }
+        buffers.removeAll(keepCapacity: true)
+        free.removeAll(keepCapacity: true)
+    }
+    
+    private var maximumInput: Int {
+        return bufferSize - kCCBlockSizeAES128
+    }
+    
+    private func takeBuffer() -> UnsafeMutablePointer<UInt8> {
+        dispatch_semaphore_wait(available, DISPATCH_TIME_FOREVER)
+        return lock.withLock { free.removeLast() }
+    }
+    
+    private func returnBuffer(buffer: UnsafeMutablePointer<UInt8>) {
+        lock.withLock { free.append(buffer) }
+        dispatch_semaphore_signal(available)
+    }
+    
+    private var hasFailed: Bool {
+        return lock.withLock { failure != nil }
+    }
+    
+    private func fail(error: ErrorType, input: dispatch_io_t) {
+        let isFirst: Bool = lock.withLock {
+            guard failure == nil else { return false }
+            failure = error
+            return true
+        }
+        if isFirst {
+            dispatch_io_close(input, DISPATCH_IO_STOP)
+        }
+    }
+    
+    private func emit(buffer: UnsafeMutablePointer<UInt8>, count: Int, to output: dispatch_io_t, group: dispatch_group_t, input: dispatch_io_t) {
+        guard count > 0 else {
+            returnBuffer(buffer)
+            return
+        }
+        
+        let region = dispatch_data_create(buffer, count, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+            self.returnBuffer(buffer)
+        }
+        
+        dispatch_group_enter(group)
+        dispatch_io_write(output, writeOffset, region, writeQueue) { done, _, error in
+            if error != 0 {
+                self.fail(posixError(error), input: input)
+            }
+            if done {
+                dispatch_group_leave(group)
+            }
+        }
+        writeOffset += off_t(count)
+    }
+    
+    private func process(data: UnsafeBufferPointer<Void>, to output: dispatch_io_t, group: dispatch_group_t, input: dispatch_io_t) throws {
+        var bytes = UnsafePointer<UInt8>(data.baseAddress)
+        var remaining = data.count
+        while remaining > 0 {
+            let count = min(remaining, maximumInput)
+            let buffer = takeBuffer()
+            var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: buffer, count: bufferSize)
+            let produced: Int
+            do {
+                produced = try cryptor.update(UnsafeBufferPointer(start: bytes, count: count), output: &out)
+            } catch {
+                returnBuffer(buffer)
+                throw error
+            }
+            emit(buffer, count: produced, to: output, group: group, input: input)
+            bytes += count
+            remaining -= count
+        }
+    }
+    
+    private func finish(to output: dispatch_io_t, group: dispatch_group_t, input: dispatch_io_t) throws {
+        let buffer = takeBuffer()
+        var out = UnsafeMutableBufferPointer<Void>(start: buffer, count: bufferSize)
+        let produced: Int
+        do {
+            produced = try cryptor.finalize(&out)
+        } catch {
+            returnBuffer(buffer)
+            throw error
+        }
+        emit(buffer, count: produced, to: output, group: group, input: input)
+    }
+    
+    /// Read all data from `input`, process it, and write the result to
+    /// `output`.
+    ///
+    /// - parameter input: A channel to read from. It will be read until the
+    ///   end of the file. If an error occurs, it is closed.
+    /// - parameter output: A channel to write to. Writes are issued at
+    ///   increasing offsets from zero; for stream channels, the offset is
+    ///   ignored.
+    /// - parameter completion: Called when all data has been written, or after
+    ///   the first error. If the operation failed, the error is passed; it
+    ///   is either a `CryptoError` from the cryptor or the arena, or an error
+    ///   in `NSPOSIXErrorDomain` from either channel.
+    public func run(from input: dispatch_io_t, to output: dispatch_io_t, completion: ErrorType? -> Void) {
+        let group = dispatch_group_create()
+        lock.withLock { failure = nil }
+        writeOffset = 0
+        
+        do {
+            try checkOutBuffers()
+        } catch {
+            dispatch_io_close(input, DISPATCH_IO_STOP)
+            completion(error)
+            return
+        }
+        
+        dispatch_io_read(input, 0, Int.max, queue) { done, data, error in
+            if error != 0 && error != ECANCELED {
+                self.fail(posixError(error), input: input)
+            }
+            
+            if let data = data where !self.hasFailed {
+                dispatch_data_apply(data) { _, _, bytes, count in
+                    do {
+                        try self.process(UnsafeBufferPointer(start: bytes, count: count), to: output, group: group, input: input)
+                        return true
+                    } catch {
+                        self.fail(error, input: input)
+                        return false
+                    }
+                }
+            }
+            
+            guard done else { return }
+            
+            if !self.hasFailed {
+                do {
+                    try self.finish(to: output, group: group, input: input)
+                } catch {
+                    self.fail(error, input: input)
+                }
+            }
+            
+            dispatch_group_notify(group, self.queue) {
+                self.checkInBuffers()
+                completion(self.lock.withLock { self.failure })
+            }
+        }
+    }
+    
+}
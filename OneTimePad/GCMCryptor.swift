@@ -0,0 +1,259 @@
+//
+//  GCMCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// Authenticated encryption with AES in Galois/Counter Mode (GCM).
+///
+/// GCM encrypts and authenticates in a single pass over the data: each call
+/// to `update` both transforms the text and folds it into the tag, so the
+/// data is read exactly once.
+///
+/// The general operation of a `GCMCryptor` is:
+///  - Initialize it with raw key data and an IV (nonce). An IV must never be
+///    reused with the same key.
+///  - Optionally, provide additional authenticated data (AAD) via one or more
+///    calls to `addAuthenticatedData`. AAD is authenticated but not
+///    encrypted, and must be provided before any text.
+///  - Process the text via one or more calls to `update`. The output is
+///    always exactly the same length as the input.
+///  - When encrypting, obtain the tag with `finalize`. When decrypting, check
+///    the expected tag with `verify`, and discard the output if it throws.
+///  - Reuse the context with the same key by calling `reset` with a new IV.
+///
+/// A given `GCMCryptor` can only be used by one thread at a time.
+public final class GCMCryptor: CCPointer {
+    
+    /// The length of a full GCM tag, in bytes.
+    public static let tagLength = 16
+    /// The shortest tag accepted by `finalize` and `verify`, in bytes.
+    public static let minimumTagLength = 12
+    /// The recommended length of an IV, in bytes.
+    public static let ivLength = 12
+    
+    /// The direction of this context.
+    public let operation: Cryptor.Operation
+    private(set) var rawPointer = Cryptor.RawCryptor()
+    
+    private init(operation: Cryptor.Operation, key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>) throws {
+        self.operation = operation
+        let configuration = Cryptor.Configuration(mode: .GCM, algorithm: .AES, padding: .None, iv: nil, tweak: nil, numberOfRounds: nil)
+        try Cryptor.createCryptor(operation: operation.rawValue, configuration: configuration, key: key, cryptor: &rawPointer)
+        try addIV(iv)
+    }
+    
+    deinit {
+        CCCryptorRelease(rawPointer)
+    }
+    
+    /// Create a context for authenticated encryption.
+    ///
+    /// - parameter key: Raw key material, 16, 24, or 32 bytes.
+    /// - parameter iv: The initialization vector. Should be `ivLength` bytes,
+    ///   and must be unique for each message encrypted with the same key.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forEncryption key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>) throws {
+        try self.init(operation: .Encrypt, key: key, iv: iv)
+    }
+    
+    /// Create a context for authenticated decryption.
+    ///
+    /// - parameter key: Raw key material, 16, 24, or 32 bytes.
+    /// - parameter iv: The initialization vector used for encryption.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forDecryption key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>) throws {
+        try self.init(operation: .Decrypt, key: key, iv: iv)
+    }
+    
+    private func addIV(iv: UnsafeBufferPointer<Void>) throws {
+        guard iv.count > 0 else {
+            throw CryptoError.InvalidParameters
+        }
+        try call {
+            CCCryptorGCMAddIV($0, iv.baseAddress, iv.count)
+        }
+    }
+    
+    /// Process some additional authenticated data.
+    ///
+    /// This method can be called multiple times, but only before the first
+    /// call to `update`.
+    ///
+    /// - parameter data: Data to authenticate.
+    public func addAuthenticatedData(data: UnsafeBufferPointer<Void>) throws {
+        try call {
+            CCCryptorGCMAddAAD($0, data.baseAddress, data.count)
+        }
+    }
+    
+    /// Process (encrypt or decrypt) some data. The result is written to a
+    /// caller-provided buffer.
+    ///
+    /// This method can be called multiple times. The input does not need to
+    /// be aligned to the block size.
+    ///
+    /// - parameter data: Data to process.
+    /// - parameter output: The result is written here. Must be allocated by
+    ///   the caller, with space for at least `data.count` bytes. Encryption
+    ///   and decryption can be performed "in-place", with the same buffer
+    ///   used for input and output.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    public func update(data: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard output.count >= data.count else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        probe(.Bytes(data.count))
+        switch operation {
+        case .Encrypt:
+            try call {
+                CCCryptorGCMEncrypt($0, data.baseAddress, data.count, output.baseAddress)
+            }
+        case .Decrypt:
+            try call {
+                CCCryptorGCMDecrypt($0, data.baseAddress, data.count, output.baseAddress)
+            }
+        }
+        return data.count
+    }
+    
+    private static func isValidTagLength(length: Int) -> Bool {
+        return length >= minimumTagLength && length <= tagLength
+    }
+    
+    private func computeTag(output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        var length = output.count
+        try call {
+            CCCryptorGCMFinal($0, output.baseAddress, &length)
+        }
+        return length
+    }
+    
+    /// Finish an encryption, and obtain the tag.
+    ///
+    /// Upon successful return, the `GCMCryptor` must be `reset` before it
+    /// can be used again.
+    ///
+    /// - parameter tag: The tag is written here. Must be allocated by the
+    ///   caller, and be between `minimumTagLength` and `tagLength` bytes;
+    ///   shorter tags are truncated, and offer less security.
+    /// - returns: The number of bytes written to `tag`.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if called on a context for
+    ///     decryption, or if `tag` is not a valid tag length.
+    public func finalize(tag: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard operation == .Encrypt && GCMCryptor.isValidTagLength(tag.count) else {
+            throw CryptoError.InvalidParameters
+        }
+        return try computeTag(tag)
+    }
+    
+    /// Finish a decryption, and check the tag.
+    ///
+    /// The comparison takes the same time wherever the tags differ. If it
+    /// fails, all output produced by `update` must be discarded.
+    ///
+    /// Upon return, the `GCMCryptor` must be `reset` before it can be used
+    /// again.
+    ///
+    /// - parameter tag: The tag produced by encryption.
+    /// - throws:
+    ///   - `CryptoError.DecodingFailure` if the tag does not match,
+    ///     indicating tampered data, or the wrong key, IV, or AAD.
+    ///   - `CryptoError.InvalidParameters` if called on a context for
+    ///     encryption, or if `tag` is not a valid tag length.
+    public func verify(tag: UnsafeBufferPointer<Void>) throws {
+        guard operation == .Decrypt && GCMCryptor.isValidTagLength(tag.count) else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        var computed = [UInt8](count: GCMCryptor.tagLength, repeatedValue: 0)
+        defer { computed.secureZero() }
+        let length = try computed.withUnsafeMutableBufferPointer { (inout buffer: UnsafeMutableBufferPointer<UInt8>) in
+            try self.computeTag(UnsafeMutableBufferPointer(start: UnsafeMutablePointer(buffer.baseAddress), count: tag.count))
+        }
+        
+        let matches = computed.withUnsafeBufferPointer {
+            length == tag.count && constantTimeEquals($0.baseAddress, tag.baseAddress, count: length)
+        }
+        guard matches else {
+            throw CryptoError.DecodingFailure
+        }
+    }
+    
+    /// Reinitialize an existing `GCMCryptor` for another message with the
+    /// same key.
+    ///
+    /// Any pending data or AAD is discarded.
+    ///
+    /// - parameter iv: The initialization vector for the next message.
+    public func reset(iv: UnsafeBufferPointer<Void>) throws {
+        probe(.Reset)
+        try call {
+            CCCryptorGCMReset($0)
+        }
+        try addIV(iv)
+    }
+    
+}
+
+public extension GCMCryptor {
+    
+    /// Stateless, one-shot authenticated encryption.
+    ///
+    /// - parameter key: Raw key material, 16, 24, or 32 bytes.
+    /// - parameter iv: The initialization vector; must be unique for each
+    ///   message encrypted with the same key.
+    /// - parameter authenticatedData: Data to authenticate but not encrypt.
+    /// - parameter input: Data to encrypt.
+    /// - parameter output: The ciphertext is written here. Must be allocated
+    ///   by the caller, with space for at least `input.count` bytes.
+    /// - parameter tag: The tag is written here.
+    /// - returns: The number of bytes written to `tag`.
+    static func seal(key key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>, authenticatedData: UnsafeBufferPointer<Void> = UnsafeBufferPointer(start: nil, count: 0), input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, tag: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let gcm = try GCMCryptor(forEncryption: key, iv: iv)
+        try gcm.addAuthenticatedData(authenticatedData)
+        try gcm.update(input, output: output)
+        return try gcm.finalize(tag)
+    }
+    
+    /// Stateless, one-shot authenticated decryption.
+    ///
+    /// If an error is thrown, `output` is wiped.
+    ///
+    /// - parameter key: Raw key material, 16, 24, or 32 bytes.
+    /// - parameter iv: The initialization vector used for encryption.
+    /// - parameter authenticatedData: The data authenticated at encryption.
+    /// - parameter input: Data to decrypt.
+    /// - parameter output: The plaintext is written here. Must be allocated
+    ///   by the caller, with space for at least `input.count` bytes.
+    /// - parameter tag: The tag produced by encryption.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.DecodingFailure` if the tag does not match.
+    static func open(key key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>, authenticatedData: UnsafeBufferPointer<Void> = UnsafeBufferPointer(start: nil, count: 0), input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, tag: UnsafeBufferPointer<Void>) throws -> Int {
+        let gcm = try GCMCryptor(forDecryption: key, iv: iv)
+        do {
+            try gcm.addAuthenticatedData(authenticatedData)
+            let length = try gcm.update(input, output: output)
+            try gcm.verify(tag)
+            return length
+        } catch {
+            secureZero(output.baseAddress, count: min(input.count, output.count))
+            throw error
+        }
+    }
+    
+}
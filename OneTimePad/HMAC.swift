@@ -0,0 +1,173 @@
+//
+//  HMAC.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// This interface provides access to keyed-hash message authentication codes
+/// (HMAC) over the digest algorithms in CommonCrypto.
+///
+/// The general operation of an HMAC is:
+///  - Initialize it with an algorithm and raw key data. The key is processed
+///    into the inner and outer padded states exactly once, here.
+///  - Process input data via one or more calls to the `update` method.
+///  - Obtain the MAC with the `finalize` method, written to caller-supplied
+///    memory. The `HMAC` is then restored to its keyed state, ready to
+///    authenticate another message without re-processing the key.
+///
+/// An `HMAC` is a value type holding its state inline. Copying it is a cheap
+/// clone of the keyed state, so one keyed `HMAC` can be shared as a template
+/// by many threads, each working on its own copy.
+public struct HMAC {
+    
+    /// The digest algorithm being used.
+    public let algorithm: Digest.Algorithm
+    private let keyed: CCHmacContext
+    private var context: CCHmacContext
+    
+    /// Create a context for authenticating data.
+    ///
+    /// - parameter algorithm: Defines the underlying digest algorithm.
+    /// - parameter key: Raw key material. Can be any length, including zero.
+    public init(algorithm: Digest.Algorithm, key: UnsafeBufferPointer<Void>) {
+        var keyed = CCHmacContext()
+        CCHmacInit(&keyed, algorithm.hmacAlgorithm, key.baseAddress, key.count)
+        self.algorithm = algorithm
+        self.keyed = keyed
+        self.context = keyed
+    }
+    
+    /// Restore the `HMAC` to its keyed state, discarding any data processed
+    /// so far.
+    public mutating func reset() {
+        context = keyed
+    }
+    
+    /// Process some data.
+    ///
+    /// This method can be called multiple times.
+    ///
+    /// - parameter data: Data to process.
+    public mutating func update(data: UnsafeBufferPointer<Void>) {
+        CCHmacUpdate(&context, data.baseAddress, data.count)
+    }
+    
+    /// Obtain the final message authentication code of all data provided to
+    /// `update`.
+    ///
+    /// Upon successful return, the `HMAC` is reset to its keyed state.
+    ///
+    /// - parameter output: The MAC is written here. Must be allocated by the
+    ///   caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No state has been lost.
+    public mutating func finalize(inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let length = algorithm.digestLength
+        guard output.count >= length else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        CCHmacFinal(&context, output.baseAddress)
+        reset()
+        return length
+    }
+    
+}
+
+private extension Digest.Algorithm {
+    
+    var hmacAlgorithm: CCHmacAlgorithm {
+        switch self {
+        case .MD5: return .MD5
+        case .SHA1: return .SHA1
+        case .SHA224: return .SHA224
+        case .SHA256: return .SHA256
+        case .SHA384: return .SHA384
+        case .SHA512: return .SHA512
+        }
+    }
+    
+}
+
+public extension HMAC {
+    
+    /// Authenticate a complete message using the keyed state, without
+    /// disturbing any data pending in `update`.
+    ///
+    /// - parameter data: Data to authenticate.
+    /// - parameter output: The MAC is written here. Must be allocated by the
+    ///   caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    func authenticate(data: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        var message = self
+        message.reset()
+        message.update(data)
+        return try message.finalize(&output)
+    }
+    
+    /// Authenticate many complete messages using the keyed state.
+    ///
+    /// The MACs are written back-to-back, in the order of `messages`, such
+    /// that the MAC for the message at index `i` begins at byte offset
+    /// `i * algorithm.digestLength` of `output`.
+    ///
+    /// - parameter messages: Data to authenticate.
+    /// - parameter output: The MACs are written here. Must be allocated by the
+    ///   caller, with space for at least
+    ///   `messages.count * algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No MACs will have been written.
+    func authenticate(messages: [UnsafeBufferPointer<Void>], inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let length = algorithm.digestLength
+        let needed = messages.count * length
+        guard output.count >= needed else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        var context = CCHmacContext()
+        var mac = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        for data in messages {
+            context = keyed
+            CCHmacUpdate(&context, data.baseAddress, data.count)
+            CCHmacFinal(&context, mac)
+            mac += length
+        }
+        return needed
+    }
+    
+    /// Stateless, one-shot HMAC.
+    ///
+    /// Prefer creating an `HMAC` and calling `authenticate` when using the
+    /// same key for more than one message.
+    ///
+    /// - parameter algorithm: Defines the underlying digest algorithm.
+    /// - parameter key: Raw key material. Can be any length, including zero.
+    /// - parameter data: Data to authenticate.
+    /// - parameter output: The MAC is written here. Must be allocated by the
+    ///   caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    static func authenticateWithAlgorithm(algorithm alg: Digest.Algorithm, key: UnsafeBufferPointer<Void>, data: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let length = alg.digestLength
+        guard output.count >= length else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        CCHmac(alg.hmacAlgorithm, key.baseAddress, key.count, data.baseAddress, data.count, output.baseAddress)
+        return length
+    }
+    
+}
@@ -0,0 +1,115 @@
+//
+//  Instrumentation.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// An event reported from a hot path in the framework.
+enum Probe {
+    /// A call into CommonCrypto returning a status.
+    case Call
+    /// A call into CommonCrypto returned an error.
+    case Failure(CCStatus)
+    /// Bytes of input passed to a cryptor.
+    case Bytes(Int)
+    /// A cryptor was created, performing key expansion.
+    case Creation
+    /// A cryptor was reset for reuse.
+    case Reset
+}
+
+/// Report an event to the instrumentation counters.
+///
+/// Unless the framework is built with `-D ONETIMEPAD_INSTRUMENTATION` in
+/// `OTHER_SWIFT_FLAGS`, this is empty and is inlined away entirely.
+@inline(__always) func probe(event: Probe) {
+    #if ONETIMEPAD_INSTRUMENTATION
+    Instrumentation.record(event)
+    #endif
+}
+
+#if ONETIMEPAD_INSTRUMENTATION
+
+/// Low-overhead counters for the framework's use of CommonCrypto.
+///
+/// Only available when the framework is built with
+/// `-D ONETIMEPAD_INSTRUMENTATION`. Each counter is updated with a single
+/// atomic add; no locks are taken on any hot path.
+public enum Instrumentation {
+    
+    /// A point-in-time copy of the counters.
+    public struct Counters {
+        /// The number of calls into CommonCrypto that return a status.
+        public let calls: Int64
+        /// The number of bytes passed to cryptors.
+        public let bytesProcessed: Int64
+        /// The number of cryptors created.
+        public let creations: Int64
+        /// The number of cryptors reset for reuse.
+        public let resets: Int64
+        /// The number of failed calls, by error.
+        public let failures: [CryptoError: Int64]
+        /// The number of failed calls with a status not known to
+        /// `CryptoError`.
+        public let otherFailures: Int64
+    }
+    
+    /// Statuses from `kCCParamError` down to `kCCRNGFailure`, plus one for
+    /// any other.
+    private static let failureSlots = 9
+    private static let counters: UnsafeMutablePointer<Int64> = {
+        let counters = UnsafeMutablePointer<Int64>.alloc(4 + failureSlots)
+        counters.initializeFrom(Repeat(count: 4 + failureSlots, repeatedValue: 0))
+        return counters
+    }()
+    
+    private static func failureSlot(status: CCStatus) -> Int {
+        guard status <= kCCParamError && status >= kCCRNGFailure else { return failureSlots - 1 }
+        return Int(kCCParamError - status)
+    }
+    
+    static func record(event: Probe) {
+        switch event {
+        case .Call:
+            OSAtomicIncrement64(counters)
+        case .Bytes(let count):
+            OSAtomicAdd64(Int64(count), counters + 1)
+        case .Creation:
+            OSAtomicIncrement64(counters + 2)
+        case .Reset:
+            OSAtomicIncrement64(counters + 3)
+        case .Failure(let status):
+            OSAtomicIncrement64(counters + 4 + failureSlot(status))
+        }
+    }
+    
+    /// Read the current value of every counter.
+    ///
+    /// Counters are read individually, so a snapshot taken while other
+    /// threads are running may be slightly inconsistent between fields.
+    public static func snapshot() -> Counters {
+        OSMemoryBarrier()
+        var failures = [CryptoError: Int64]()
+        for slot in 0 ..< failureSlots - 1 {
+            let count = counters[4 + slot]
+            guard count != 0 else { continue }
+            failures[CryptoError(kCCParamError - CCStatus(slot))] = count
+        }
+        return Counters(calls: counters[0], bytesProcessed: counters[1], creations: counters[2], resets: counters[3], failures: failures, otherFailures: counters[3 + failureSlots])
+    }
+    
+    /// Set every counter back to zero.
+    public static func reset() {
+        for index in 0 ..< 4 + failureSlots {
+            OSAtomicAdd64(-counters[index], counters + index)
+        }
+    }
+    
+}
+
+#endif
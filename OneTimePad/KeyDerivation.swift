@@ -0,0 +1,195 @@
+//
+//  KeyDerivation.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+import Foundation
+
+/// This interface provides access to password-based key derivation (PBKDF2)
+/// in CommonCrypto.
+///
+/// The cost of a derivation is set by its number of rounds. Rather than fixing
+/// a round count, `calibratedRounds` finds the count that takes a target
+/// amount of time on the current device; the result is cached in memory and
+/// in the user defaults, so calibration runs once per device rather than on
+/// every launch.
+public enum KeyDerivation {
+    
+    private static let defaultsKey = "me.waldowski.OneTimePad.KeyDerivation.CalibratedRounds"
+    private static let lock = Mutex()
+    private static var calibrations: [String: Int]?
+    
+    /// Derive a key from a password.
+    ///
+    /// - parameter password: The password, as raw octets. The same encoding
+    ///   and normalization must be used each time the key is derived.
+    /// - parameter salt: The salt.
+    /// - parameter pseudoRandomAlgorithm: The HMAC digest algorithm used for
+    ///   each round. Must not be `MD5`.
+    /// - parameter rounds: The number of rounds.
+    /// - parameter output: The derived key is written here. Its entire length
+    ///   is filled, defining the length of the key.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` for an unsupported algorithm or a
+    ///     round count that is out of range.
+    public static func deriveKey(password password: UnsafeBufferPointer<Void>, salt: UnsafeBufferPointer<Void>, pseudoRandomAlgorithm prf: Digest.Algorithm = .SHA256, rounds: Int, output: UnsafeMutableBufferPointer<Void>) throws {
+        guard rounds > 0 && rounds <= Int(UInt32.max) else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        let raw = try prf.pseudoRandomAlgorithm()
+        try cc_call {
+            CCKeyDerivationPBKDF(kCCPBKDF2, UnsafePointer(password.baseAddress), password.count, UnsafePointer(salt.baseAddress), salt.count, raw, UInt32(rounds), UnsafeMutablePointer(output.baseAddress), output.count)
+        }
+    }
+    
+    /// Measure the number of rounds for a derivation with the given
+    /// parameters to take approximately `milliseconds` on this device.
+    ///
+    /// This runs the derivation repeatedly, and takes some time. Prefer
+    /// `calibratedRounds`, which caches the result.
+    ///
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` for an unsupported algorithm.
+    public static func calibrateRounds(passwordLength passwordLength: Int, saltLength: Int, pseudoRandomAlgorithm prf: Digest.Algorithm = .SHA256, derivedKeyLength: Int, milliseconds: UInt32) throws -> Int {
+        let rounds = CCCalibratePBKDF(kCCPBKDF2, passwordLength, saltLength, try prf.pseudoRandomAlgorithm(), derivedKeyLength, milliseconds)
+        guard rounds != 0 && rounds != UInt32.max else {
+            throw CryptoError.InvalidParameters
+        }
+        return Int(rounds)
+    }
+    
+    /// The number of rounds for a derivation with the given parameters to
+    /// take approximately `milliseconds` on this device.
+    ///
+    /// The first request for a set of parameters runs `calibrateRounds`.
+    /// Later requests, including those in later launches, return the same
+    /// value until the hardware model or operating system version changes.
+    ///
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` for an unsupported algorithm.
+    public static func calibratedRounds(passwordLength passwordLength: Int, saltLength: Int, pseudoRandomAlgorithm prf: Digest.Algorithm = .SHA256, derivedKeyLength: Int, milliseconds: UInt32) throws -> Int {
+        let profile = "\(deviceProfile)/\(prf)/\(passwordLength)/\(saltLength)/\(derivedKeyLength)/\(milliseconds)"
+        if let rounds = lock.withLock({ loadCalibrations()[profile] }) {
+            return rounds
+        }
+        
+        let rounds = try calibrateRounds(passwordLength: passwordLength, saltLength: saltLength, pseudoRandomAlgorithm: prf, derivedKeyLength: derivedKeyLength, milliseconds: milliseconds)
+        lock.withLock {
+            var all = loadCalibrations()
+            all[profile] = rounds
+            calibrations = all
+            NSUserDefaults.standardUserDefaults().setObject(all, forKey: defaultsKey)
+        }
+        return rounds
+    }
+    
+    /// Discard all cached calibrations, in memory and in the user defaults.
+    public static func removeCalibratedRounds() {
+        lock.withLock {
+            calibrations = [:]
+            NSUserDefaults.standardUserDefaults().removeObjectForKey(defaultsKey)
+        }
+    }
+    
+    /// Must be called with `lock` held.
+    private static func loadCalibrations() -> [String: Int] {
+        if let loaded = calibrations {
+            return loaded
+        }
+        let stored = NSUserDefaults.standardUserDefaults().dictionaryForKey(defaultsKey) as? [String: Int] ?? [:]
+        calibrations = stored
+        return stored
+    }
+    
+    /// Identifies the hardware model and operating system build, which
+    /// together determine the speed of a derivation.
+    private static let deviceProfile: String = {
+        func sysctlString(name: String) -> String {
+            var length = 0
+            guard sysctlbyname(name, nil, &length, nil, 0) == 0 && length > 0 else { return "unknown" }
+            var value = [CChar](count: length, repeatedValue: 0)
+            guard sysctlbyname(name, &value, &length, nil, 0) == 0 else { return "unknown" }
+            return String.fromCString(value) ?? "unknown"
+        }
+        return "\(sysctlString("hw.model"))/\(sysctlString("kern.osversion"))"
+    }()
+    
+}
+
+extension Digest.Algorithm {
+    
+    func pseudoRandomAlgorithm() throws -> CCPseudoRandomAlgorithm {
+        switch self {
+        case .MD5: throw CryptoError.InvalidParameters
+        case .SHA1: return kCCPRFHmacAlgSHA1
+        case .SHA224: return kCCPRFHmacAlgSHA224
+        case .SHA256: return kCCPRFHmacAlgSHA256
+        case .SHA384: return kCCPRFHmacAlgSHA384
+        case .SHA512: return kCCPRFHmacAlgSHA512
+        }
+    }
+    
+}
+
+public extension KeyDerivation {
+    
+    /// A password and salt to derive a key from.
+    typealias Credential = (password: UnsafeBufferPointer<Void>, salt: UnsafeBufferPointer<Void>)
+    
+    /// Derive many keys with the same parameters, in parallel.
+    ///
+    /// Credentials are spread across `queue` with `dispatch_apply`, which
+    /// runs roughly one derivation per active processor at a time. The keys are written back-to-back, in the order of
+    /// `credentials`, such that the key at index `i` begins at byte offset
+    /// `i * keyLength` of `output`.
+    ///
+    /// An `NSProgress` is created as a child of the current progress, if
+    /// any, with one unit of work per credential. Cancelling it stops the
+    /// batch as soon as the derivations in flight finish.
+    ///
+    /// - parameter credentials: The passwords and salts.
+    /// - parameter pseudoRandomAlgorithm: The HMAC digest algorithm used for
+    ///   each round. Must not be `MD5`.
+    /// - parameter rounds: The number of rounds.
+    /// - parameter keyLength: The length of each derived key.
+    /// - parameter output: The keys are written here. Must be allocated by
+    ///   the caller, with space for at least `credentials.count * keyLength`
+    ///   bytes.
+    /// - parameter queue: The queue on which derivations are performed;
+    ///   should be concurrent.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No keys will have been derived.
+    ///   - `NSUserCancelledError` in `NSCocoaErrorDomain` if the progress was
+    ///     cancelled. Some keys may have been written.
+    ///   - Any error thrown by `deriveKey`.
+    static func deriveKeys(credentials: [Credential], pseudoRandomAlgorithm prf: Digest.Algorithm = .SHA256, rounds: Int, keyLength: Int, output: UnsafeMutableBufferPointer<Void>, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) throws -> Int {
+        let needed = credentials.count * keyLength
+        guard output.count >= needed else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let progress = NSProgress(totalUnitCount: Int64(credentials.count))
+        let lock = Mutex()
+        try concurrentlyApply(credentials.count, queue: queue) { index in
+            guard !progress.cancelled else {
+                throw NSError(domain: NSCocoaErrorDomain, code: NSUserCancelledError, userInfo: nil)
+            }
+            
+            let key = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer<UInt8>(output.baseAddress) + index * keyLength, count: keyLength)
+            try deriveKey(password: credentials[index].password, salt: credentials[index].salt, pseudoRandomAlgorithm: prf, rounds: rounds, output: key)
+            lock.withLock {
+                progress.completedUnitCount += 1
+            }
+        }
+        return needed
+    }
+    
+}
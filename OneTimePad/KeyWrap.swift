@@ -0,0 +1,158 @@
+//
+//  KeyWrap.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// This interface provides access to AES key wrapping, as specified by
+/// RFC 3394, in CommonCrypto.
+///
+/// A key encryption key (KEK) of 16, 24, or 32 bytes selects AES-128,
+/// AES-192, or AES-256. Keys to be wrapped must be a multiple of 8 bytes,
+/// and at least 16 bytes long; wrapping adds 8 bytes of integrity check.
+public enum KeyWrap {
+    
+    private static let semiblockSize = 8
+    
+    /// The number of bytes needed to hold a wrapped key of `keyLength`.
+    public static func wrappedLength(forKeyLength keyLength: Int) -> Int {
+        return CCSymmetricWrappedSize(kCCWRAPAES, keyLength)
+    }
+    
+    /// The number of bytes needed to hold the key unwrapped from a wrapped
+    /// key of `wrappedLength`.
+    public static func unwrappedLength(forWrappedLength wrappedLength: Int) -> Int {
+        return max(CCSymmetricUnwrappedSize(kCCWRAPAES, wrappedLength), 0)
+    }
+    
+    private static func validateKeyLength(length: Int, minimum: Int) throws {
+        guard length >= minimum && length % semiblockSize == 0 else {
+            throw CryptoError.InvalidParameters
+        }
+    }
+    
+    private static func validateKEKLength(length: Int) throws {
+        guard length == kCCKeySizeAES128 || length == kCCKeySizeAES192 || length == kCCKeySizeAES256 else {
+            throw CryptoError.InvalidParameters
+        }
+    }
+    
+    /// Wrap a key with a key encryption key.
+    ///
+    /// - parameter key: The raw key to wrap.
+    /// - parameter kek: The key encryption key.
+    /// - parameter output: The wrapped key is written here. Must be allocated
+    ///   by the caller, with space for at least
+    ///   `wrappedLength(forKeyLength: key.count)` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if the length of either key is not
+    ///     valid.
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    public static func wrap(key: UnsafeBufferPointer<Void>, withKey kek: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        try validateKEKLength(kek.count)
+        try validateKeyLength(key.count, minimum: 2 * semiblockSize)
+        guard output.count >= wrappedLength(forKeyLength: key.count) else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        var length = output.count
+        try cc_call {
+            CCSymmetricKeyWrap(kCCWRAPAES, CCrfc3394_iv, CCrfc3394_ivLen, UnsafePointer(kek.baseAddress), kek.count, UnsafePointer(key.baseAddress), key.count, UnsafeMutablePointer(output.baseAddress), &length)
+        }
+        return length
+    }
+    
+    /// Unwrap a key with a key encryption key.
+    ///
+    /// - parameter wrappedKey: The wrapped key.
+    /// - parameter kek: The key encryption key.
+    /// - parameter output: The raw key is written here. Must be allocated by
+    ///   the caller, with space for at least
+    ///   `unwrappedLength(forWrappedLength: wrappedKey.count)` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if the length of either key is not
+    ///     valid.
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    ///   - A `CryptoError` if the integrity check fails, indicating corrupt
+    ///     data or the wrong KEK.
+    public static func unwrap(wrappedKey: UnsafeBufferPointer<Void>, withKey kek: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        try validateKEKLength(kek.count)
+        try validateKeyLength(wrappedKey.count, minimum: 3 * semiblockSize)
+        guard output.count >= unwrappedLength(forWrappedLength: wrappedKey.count) else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        var length = output.count
+        try cc_call {
+            CCSymmetricKeyUnwrap(kCCWRAPAES, CCrfc3394_iv, CCrfc3394_ivLen, UnsafePointer(kek.baseAddress), kek.count, UnsafePointer(wrappedKey.baseAddress), wrappedKey.count, UnsafeMutablePointer(output.baseAddress), &length)
+        }
+        return length
+    }
+    
+}
+
+public extension KeyWrap {
+    
+    /// Unwrap many keys under the same key encryption key.
+    ///
+    /// The raw keys are written back-to-back, in the order of `wrappedKeys`,
+    /// into a single caller-provided arena. The space needed is checked for
+    /// the whole batch before any key is unwrapped; no memory is allocated
+    /// per key.
+    ///
+    /// - parameter wrappedKeys: The wrapped keys.
+    /// - parameter kek: The key encryption key.
+    /// - parameter output: The raw keys are written here. Must be allocated
+    ///   by the caller, with space for at least the sum of
+    ///   `unwrappedLength(forWrappedLength:)` for each wrapped key.
+    /// - parameter ranges: Upon successful return, the byte range in `output`
+    ///   of each raw key. Its storage is reused, so passing the same array
+    ///   for every batch avoids allocation altogether.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if the length of the KEK or any
+    ///     key is not valid. No keys will have been unwrapped.
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No keys will have been unwrapped.
+    ///   - A `CryptoError` if the integrity check fails for any key. The keys
+    ///     written so far are wiped.
+    static func unwrap(wrappedKeys: [UnsafeBufferPointer<Void>], withKey kek: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>, inout ranges: [Range<Int>]) throws -> Int {
+        try validateKEKLength(kek.count)
+        var needed = 0
+        for wrappedKey in wrappedKeys {
+            try validateKeyLength(wrappedKey.count, minimum: 3 * semiblockSize)
+            needed += unwrappedLength(forWrappedLength: wrappedKey.count)
+        }
+        guard output.count >= needed else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        ranges.removeAll(keepCapacity: true)
+        ranges.reserveCapacity(wrappedKeys.count)
+        
+        let base = UnsafeMutablePointer<UInt8>(output.baseAddress)
+        var offset = 0
+        do {
+            for wrappedKey in wrappedKeys {
+                let slot = UnsafeMutableBufferPointer<Void>(start: base + offset, count: output.count - offset)
+                let length = try unwrap(wrappedKey, withKey: kek, output: slot)
+                ranges.append(offset ..< offset + length)
+                offset += length
+            }
+        } catch {
+            secureZero(base, count: offset)
+            ranges.removeAll(keepCapacity: true)
+            throw error
+        }
+        return offset
+    }
+    
+}
@@ -0,0 +1,141 @@
+//
+//  MappedFile.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// A shared, memory-mapped view of an open file that is unmapped from the
+/// front as the caller advances through it.
+private struct MappedFile {
+    
+    private static let pageSize = Int(getpagesize())
+    
+    let base: UnsafeMutablePointer<UInt8>
+    let length: Int
+    let writable: Bool
+    private var unmapped = 0
+    
+    init(descriptor: Int32, length: Int, writable: Bool) throws {
+        self.length = length
+        self.writable = writable
+        guard length > 0 else {
+            base = nil
+            return
+        }
+        
+        let protection = writable ? PROT_READ | PROT_WRITE : PROT_READ
+        let address = mmap(nil, length, protection, MAP_FILE | MAP_SHARED, descriptor, 0)
+        guard address != UnsafeMutablePointer(bitPattern: -1) else {
+            throw posixError(errno)
+        }
+        base = UnsafeMutablePointer(address)
+        
+        if !writable {
+            madvise(address, length, MADV_SEQUENTIAL)
+        }
+    }
+    
+    /// Give the pages before `offset` back to the system. Dirty pages are
+    /// scheduled to be written back first.
+    mutating func unmap(before offset: Int) {
+        let end = offset == length ? length : (offset / MappedFile.pageSize) * MappedFile.pageSize
+        guard end > unmapped else { return }
+        
+        let start = base + unmapped
+        if writable {
+            msync(start, end - unmapped, MS_ASYNC)
+        }
+        munmap(start, end - unmapped)
+        unmapped = end
+    }
+    
+    mutating func unmapAll() {
+        unmap(before: length)
+    }
+    
+}
+
+public extension Cryptor {
+    
+    /// Process (encrypt or decrypt) the contents of a file into another file,
+    /// then finalize.
+    ///
+    /// Both files are memory-mapped, and no heap copy of either is made. The
+    /// destination is sized up front using `outputLengthForInputLength`, then
+    /// trimmed to the number of bytes actually produced. Data is processed in
+    /// windows; the pages behind each window are unmapped as soon as they are
+    /// consumed or produced, so resident memory stays bounded regardless of
+    /// the size of the file.
+    ///
+    /// As with `update`, the `Cryptor` should be freshly created or `reset`.
+    ///
+    /// - parameter source: Path to the file to process.
+    /// - parameter destination: Path to the file to write. It will be
+    ///   created or truncated, and must not be the same file as `source`. If
+    ///   processing fails, it is removed.
+    /// - parameter windowSize: The number of bytes of input processed before
+    ///   the pages behind it are unmapped.
+    /// - parameter chunkSize: The number of bytes passed to each call to
+    ///   `update`, no more than `windowSize`. If `nil`, `preferredChunkSize`
+    ///   is used.
+    /// - returns: The number of bytes written to `destination`.
+    /// - throws:
+    ///   - An error in `NSPOSIXErrorDomain` if either file could not be opened,
+    ///     sized, or mapped.
+    ///   - Any error thrown by `update` or `finalize`.
+    func processFile(atPath source: String, toPath destination: String, windowSize: Int = 8 * 1024 * 1024, chunkSize: Int? = nil) throws -> Int {
+        let windowSize = max(windowSize, 1)
+        let chunkSize = min(max(chunkSize ?? preferredChunkSize, 1), windowSize)
+        let input = try posix_call { open(source, O_RDONLY) }
+        defer { close(input) }
+        
+        var info = stat()
+        try posix_call { fstat(input, &info) }
+        let inputLength = Int(info.st_size)
+        let capacity = outputLengthForInputLength(inputLength, finalizing: true)
+        
+        let output = try posix_call { open(destination, O_RDWR | O_CREAT | O_TRUNC, 0o644) }
+        defer { close(output) }
+        
+        do {
+            try posix_call { ftruncate(output, off_t(capacity)) }
+            
+            var from = try MappedFile(descriptor: input, length: inputLength, writable: false)
+            defer { from.unmapAll() }
+            var to = try MappedFile(descriptor: output, length: capacity, writable: true)
+            defer { to.unmapAll() }
+            
+            var read = 0
+            var written = 0
+            while read < inputLength {
+                let end = min(read + windowSize, inputLength)
+                while read < end {
+                    let count = min(chunkSize, end - read)
+                    let chunk = UnsafeBufferPointer<Void>(start: from.base + read, count: count)
+                    var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: to.base + written, count: capacity - written)
+                    written += try update(chunk, output: &out)
+                    read += count
+                }
+                
+                from.unmap(before: read)
+                to.unmap(before: written)
+            }
+            
+            var out = UnsafeMutableBufferPointer<Void>(start: to.base + written, count: capacity - written)
+            written += try finalize(&out)
+            to.unmapAll()
+            
+            try posix_call { ftruncate(output, off_t(written)) }
+            return written
+        } catch {
+            unlink(destination)
+            throw error
+        }
+    }
+    
+}
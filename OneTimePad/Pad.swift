@@ -0,0 +1,201 @@
+//
+//  Pad.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// Exclusive-or `count` bytes of `lhs` and `rhs` into `output`, which may be
+/// the same memory as either input.
+///
+/// The bulk of the work is done 32 bytes at a time as four independent
+/// machine words, which the optimizer lowers to vector loads, XORs, and
+/// stores; unaligned memory is handled by loading through `memcpy`.
+func xorBytes(output: UnsafeMutablePointer<Void>, _ lhs: UnsafePointer<Void>, _ rhs: UnsafePointer<Void>, count: Int) {
+    let out = UnsafeMutablePointer<UInt8>(output)
+    let a = UnsafePointer<UInt8>(lhs)
+    let b = UnsafePointer<UInt8>(rhs)
+    let stride = 4 * sizeof(UInt64)
+    var x = (UInt64(0), UInt64(0), UInt64(0), UInt64(0))
+    var y = (UInt64(0), UInt64(0), UInt64(0), UInt64(0))
+    var offset = 0
+    while offset + stride <= count {
+        memcpy(&x, a + offset, stride)
+        memcpy(&y, b + offset, stride)
+        x = (x.0 ^ y.0, x.1 ^ y.1, x.2 ^ y.2, x.3 ^ y.3)
+        memcpy(out + offset, &x, stride)
+        offset += stride
+    }
+    while offset < count {
+        out[offset] = a[offset] ^ b[offset]
+        offset += 1
+    }
+}
+
+/// Operations for one-time pads and other XOR keystreams.
+public enum Pad {
+    
+    /// Exclusive-or a pad into a buffer, in place.
+    ///
+    /// - parameter output: The data to combine with the pad; the result
+    ///   replaces it.
+    /// - parameter pad: The pad. Must be at least as long as `output`; any
+    ///   extra bytes are ignored.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` if `pad` is shorter than `output`.
+    public static func xor(into output: UnsafeMutableBufferPointer<Void>, with pad: UnsafeBufferPointer<Void>) throws {
+        guard pad.count >= output.count else {
+            throw CryptoError.BufferTooSmall
+        }
+        xorBytes(output.baseAddress, output.baseAddress, pad.baseAddress, count: output.count)
+    }
+    
+}
+
+public extension BufferType where Generator.Element: IntegerType {
+    
+    /// Exclusive-or a pad into the contents of the buffer, in place.
+    ///
+    /// - parameter pad: The pad. Must be at least as long as `self`; any
+    ///   extra elements are ignored.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` if `pad` is shorter than `self`.
+    mutating func xor<Other: BufferType where Other.Generator.Element == Generator.Element>(with pad: Other) throws {
+        guard numericCast(pad.count) as Int >= numericCast(count) as Int else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        withUnsafeMutableBufferPointer { buffer in
+            pad.withUnsafeBufferPointer { pad in
+                xorBytes(buffer.baseAddress, buffer.baseAddress, pad.baseAddress, count: buffer.count * sizeof(Generator.Element))
+            }
+        }
+    }
+    
+}
+
+/// A source of pad bytes that are exclusive-ored into data in place.
+///
+/// Pad bytes are produced `blockSize` at a time, either from the system
+/// random number generator or from the keystream of a `Cryptor` in a stream
+/// mode (such as CTR, OFB, or RC4), and handed out across any number of
+/// calls to `apply`. A random pad must be recorded to be reversed; a
+/// keystream pad is reproduced by a second `PadStream` with an identically
+/// configured `Cryptor`.
+///
+/// The block of pad bytes is wiped when the stream is released.
+///
+/// A given `PadStream` can only be used by one thread at a time.
+public final class PadStream {
+    
+    /// The number of pad bytes produced at a time.
+    public let blockSize: Int
+    
+    private let keystream: Cryptor?
+    private let block: UnsafeMutablePointer<UInt8>
+    private var offset: Int
+    
+    private init(keystream: Cryptor?, blockSize: Int) {
+        self.blockSize = max(blockSize, kCCBlockSizeAES128)
+        self.keystream = keystream
+        self.block = UnsafeMutablePointer.alloc(self.blockSize)
+        self.offset = self.blockSize
+        // Pad bytes are wiped as they are used, so the block is all zeroes
+        // whenever it needs to be refilled.
+        memset(block, 0, self.blockSize)
+    }
+    
+    /// Create a stream of random pad bytes.
+    ///
+    /// - parameter blockSize: The number of pad bytes to generate at a time.
+    public convenience init(blockSize: Int = 1024 * 1024) {
+        self.init(keystream: nil, blockSize: blockSize)
+    }
+    
+    /// Create a stream of pad bytes from a cryptor's keystream.
+    ///
+    /// - parameter cryptor: A freshly-created or `reset` cryptor in a stream
+    ///   mode (CTR, OFB, or RC4), with padding disabled. It must not be used
+    ///   elsewhere.
+    /// - parameter blockSize: The number of pad bytes to produce at a time.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if `cryptor` is not in a stream
+    ///     mode.
+    public convenience init(keystream cryptor: Cryptor, blockSize: Int = 1024 * 1024) throws {
+        switch cryptor.mode {
+        case .CTR, .OFB, .RC4:
+            break
+        default:
+            throw CryptoError.InvalidParameters
+        }
+        self.init(keystream: cryptor, blockSize: blockSize)
+    }
+    
+    deinit {
+        secureZero(block, count: blockSize)
+        block.dealloc(blockSize)
+    }
+    
+    private func refill() throws {
+        if let cryptor = keystream {
+            // The keystream is the encryption of zeroes.
+            var out: UnsafeMutableBufferPointer<Void>! = UnsafeMutableBufferPointer(start: block, count: blockSize)
+            do {
+                let produced = try cryptor.update(UnsafeBufferPointer(start: block, count: blockSize), output: &out)
+                guard produced == blockSize else {
+                    throw CryptoError.InvalidParameters
+                }
+            } catch {
+                secureZero(block, count: blockSize)
+                throw error
+            }
+        } else {
+            try cc_call {
+                CCRandomGenerateBytes(block, blockSize)
+            }
+        }
+        offset = 0
+    }
+    
+    /// Exclusive-or the next pad bytes into `data`, in place.
+    ///
+    /// - parameter data: The data to combine with the pad; the result
+    ///   replaces it.
+    /// - parameter pad: If present, the pad bytes used are also copied here.
+    ///   Must have space for at least `data.count` bytes.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` if `pad` is too small. No pad bytes
+    ///     will have been used.
+    ///   - `CryptoError.RNGFailure` if random pad bytes could not be
+    ///     generated.
+    ///   - `CryptoError.InvalidParameters` if the keystream cryptor does not
+    ///     produce a full block of pad bytes.
+    public func apply(data: UnsafeMutableBufferPointer<Void>, recordingPadTo pad: UnsafeMutableBufferPointer<Void>? = nil) throws {
+        guard (pad?.count ?? data.count) >= data.count else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let bytes = UnsafeMutablePointer<UInt8>(data.baseAddress)
+        let padBytes = UnsafeMutablePointer<UInt8>(pad?.baseAddress ?? nil)
+        var done = 0
+        while done < data.count {
+            if offset == blockSize {
+                try refill()
+            }
+            
+            let count = min(data.count - done, blockSize - offset)
+            if padBytes != nil {
+                (padBytes + done).assignFrom(block + offset, count: count)
+            }
+            xorBytes(bytes + done, bytes + done, block + offset, count: count)
+            secureZero(block + offset, count: count)
+            offset += count
+            done += count
+        }
+    }
+    
+}
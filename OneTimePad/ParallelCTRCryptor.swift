@@ -0,0 +1,144 @@
+//
+//  ParallelCTRCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+
+/// Counter mode encryption and decryption spread across multiple cores.
+///
+/// In counter mode, every block of keystream depends only on the key and the
+/// value of the counter for that block. A large input can therefore be split
+/// into independent chunks, each encrypted by its own cryptor whose counter
+/// starts at the IV advanced by the chunk's offset in blocks. The chunks are
+/// processed concurrently; the output is byte-for-byte identical to
+/// processing the whole input with a single `Cryptor`.
+///
+/// Encryption and decryption are the same operation in counter mode.
+///
+/// A `ParallelCTRCryptor` retains a copy of the key and IV, and can be used
+/// from multiple threads at the same time.
+public final class ParallelCTRCryptor {
+    
+    private let configuration: Cryptor.Configuration
+    private let key: SecretBytes
+    private let counter: [UInt8]
+    private let queue: dispatch_queue_t
+    
+    /// The number of bytes processed by each unit of work; a multiple of the
+    /// algorithm's block size.
+    public let chunkSize: Int
+    
+    /// Create a context for parallel counter mode.
+    ///
+    /// - parameter algorithm: Defines the algorithm; its mode must be `CTR`.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - parameter chunkSize: The number of bytes to process per unit of work.
+    ///   Rounded down to a multiple of the block size. Should be large enough
+    ///   to amortize creating a cryptor but small enough to remain in cache.
+    ///   If `nil`, the tuned chunk size for `algorithm` is used if already
+    ///   known, but no less than 256 KB; tuning never blocks the caller.
+    /// - parameter queue: The queue on which chunks are processed; should be
+    ///   concurrent.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if `algorithm` is not in counter
+    ///     mode.
+    public init(algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, chunkSize: Int? = nil, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) throws {
+        let configuration = Cryptor.Configuration(algorithm)
+        let blockSize = algorithm.blockSize
+        guard configuration.mode == .CTR && blockSize > 0 else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        var counter = [UInt8](count: blockSize, repeatedValue: 0)
+        if configuration.iv != nil {
+            counter.withUnsafeMutableBufferPointer { buffer in
+                buffer.baseAddress.initializeFrom(UnsafeMutablePointer(configuration.iv), count: blockSize)
+            }
+        }
+        
+        self.configuration = configuration
+        self.key = SecretBytes(copying: key)
+        self.counter = counter
+        self.queue = queue
+        // Never go below 256 KB, since each chunk creates a cryptor.
+        let chunkSize = chunkSize ?? max(ChunkSizeTuner.cachedChunkSize(algorithm: configuration.algorithm, mode: configuration.mode), 256 * 1024)
+        self.chunkSize = max(chunkSize / blockSize, 1) * blockSize
+    }
+    
+    /// Add `blocks` to a big-endian counter, in place.
+    private static func advance(counter: UnsafeMutableBufferPointer<UInt8>, by blocks: UInt64) {
+        var carry = blocks
+        var index = counter.count - 1
+        while index >= 0 && carry != 0 {
+            let sum = UInt64(counter[index]) + (carry & 0xFF)
+            counter[index] = UInt8(truncatingBitPattern: sum)
+            carry = (carry >> 8) + (sum >> 8)
+            index -= 1
+        }
+    }
+    
+    private func cryptChunk(index: Int, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws {
+        let start = index * chunkSize
+        let length = min(chunkSize, input.count - start)
+        let blocksPerChunk = UInt64(chunkSize / self.counter.count)
+        
+        var counter = self.counter
+        try counter.withUnsafeMutableBufferPointer { (inout counter: UnsafeMutableBufferPointer<UInt8>) in
+            ParallelCTRCryptor.advance(counter, by: UInt64(index) * blocksPerChunk)
+            
+            let c = configuration
+            let chunk = Cryptor.Configuration(mode: c.mode, algorithm: c.algorithm, padding: c.padding, iv: UnsafePointer(counter.baseAddress), tweak: nil, numberOfRounds: c.numberOfRounds)
+            var cryptor = Cryptor.RawCryptor()
+            try Cryptor.createCryptor(operation: .Encrypt, configuration: chunk, key: key.buffer, cryptor: &cryptor)
+            defer {
+                CCCryptorRelease(cryptor)
+            }
+            
+            var moved = 0
+            probe(.Bytes(length))
+            try cc_call {
+                CCCryptorUpdate(cryptor, UnsafePointer<UInt8>(input.baseAddress) + start, length, UnsafeMutablePointer<UInt8>(output.baseAddress) + start, length, &moved)
+            }
+        }
+    }
+    
+    /// Encrypt or decrypt data.
+    ///
+    /// Each call processes `input` from the beginning of the keystream, as
+    /// if by a new `Cryptor` created with the same algorithm and key.
+    ///
+    /// - parameter input: Data to encrypt or decrypt.
+    /// - parameter output: The result is written here. Must be allocated by
+    ///   the caller with space for at least `input.count` bytes. Encryption
+    ///   and decryption can be performed "in-place", with the same buffer used
+    ///   for input and output.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    public func crypt(input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard output.count >= input.count else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let chunkCount = (input.count + chunkSize - 1) / chunkSize
+        guard chunkCount > 1 else {
+            if chunkCount == 1 {
+                try cryptChunk(0, input: input, output: output)
+            }
+            return input.count
+        }
+        
+        try concurrentlyApply(chunkCount, queue: queue) { index in
+            try self.cryptChunk(index, input: input, output: output)
+        }
+        return input.count
+    }
+    
+}
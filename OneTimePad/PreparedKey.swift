@@ -0,0 +1,276 @@
+//
+//  PreparedKey.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// A key whose schedule has been expanded once, for one algorithm and
+/// direction.
+///
+/// A `PreparedKey` holds a small stack of keyed cryptors. A working cryptor
+/// for a new IV is one of these, `reset` with that IV; the key expansion in
+/// `CCCryptorCreateWithMode` happens only when every cryptor is already in
+/// use. At most `maximumIdleCount` idle cryptors are kept.
+///
+/// Reuse is limited to ECB and CBC. On the deployment target, resetting a
+/// CTR, CFB, or OFB cryptor can succeed without restarting its counter or
+/// feedback register, so for those modes every use creates a fresh cryptor
+/// from the retained key; only the lookup and key copy are saved. Stream
+/// ciphers (i.e., RC4) cannot be reset, and cannot be prepared.
+///
+/// A `PreparedKey` retains a copy of the key material, which is wiped when it
+/// is released. It can be used from multiple threads at the same time.
+public final class PreparedKey {
+    
+    /// The direction of the cryptors made from this key.
+    public let operation: Cryptor.Operation
+    /// The maximum number of idle cryptors retained.
+    public let maximumIdleCount: Int
+    
+    private let configuration: Cryptor.Configuration
+    private let blockSize: Int
+    private let key: SecretBytes
+    private let tweak: SecretBytes?
+    private let lock = Mutex()
+    private var idle = [Cryptor]()
+    
+    init(operation: Cryptor.Operation, algorithm alg: Cryptor.Algorithm, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>, maximumIdleCount: Int) throws {
+        guard c.mode != .RC4 else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        let tweak = c.tweak.map { SecretBytes(copying: $0) }
+        self.operation = operation
+        self.maximumIdleCount = max(maximumIdleCount, 1)
+        // The IV is only borrowed; every checkout supplies its own.
+        self.configuration = Cryptor.Configuration(mode: c.mode, algorithm: c.algorithm, padding: c.padding, iv: nil, tweak: tweak?.buffer, numberOfRounds: c.numberOfRounds)
+        self.blockSize = alg.blockSize
+        self.key = SecretBytes(copying: key)
+        self.tweak = tweak
+        if c.mode.isResettable {
+            idle.append(try Cryptor(operation: operation.rawValue, configuration: configuration, key: key))
+        }
+    }
+    
+    /// Prepare a key for encryption.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode. Any IV in
+    ///   the mode is ignored; one is given for each use.
+    /// - parameter key: Raw key material. Length must be appropriate for the
+    ///   selected algorithm; some algorithms provide for varying key lengths.
+    /// - parameter maximumIdleCount: The number of idle cryptors to retain;
+    ///   roughly, the number of threads expected to use the key at once.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`, including for stream ciphers.
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forEncryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, maximumIdleCount: Int = 4) throws {
+        try self.init(operation: .Encrypt, algorithm: algorithm, configuration: Cryptor.Configuration(algorithm), key: key, maximumIdleCount: maximumIdleCount)
+    }
+    
+    /// Prepare a key for decryption.
+    ///
+    /// - seealso: init(forEncryption:key:maximumIdleCount:)
+    public convenience init(forDecryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, maximumIdleCount: Int = 4) throws {
+        try self.init(operation: .Decrypt, algorithm: algorithm, configuration: Cryptor.Configuration(algorithm), key: key, maximumIdleCount: maximumIdleCount)
+    }
+    
+    func matches(operation op: Cryptor.Operation, configuration c: Cryptor.Configuration, key: UnsafeBufferPointer<Void>) -> Bool {
+        let lhs = configuration
+        guard op == operation && c.mode == lhs.mode && c.algorithm == lhs.algorithm && c.padding == lhs.padding && (c.numberOfRounds ?? 0) == (lhs.numberOfRounds ?? 0) else { return false }
+        switch (c.tweak, tweak) {
+        case (.None, .None):
+            break
+        case let (.Some(lhs), .Some(rhs)) where rhs.matches(lhs):
+            break
+        default:
+            return false
+        }
+        return self.key.matches(key)
+    }
+    
+    /// Borrow a cryptor, reset with `iv`, for the duration of `body`.
+    ///
+    /// The cryptor is returned when `body` exits. It must not be retained or
+    /// used after that point.
+    ///
+    /// - parameter iv: The initialization vector, if the mode uses one. If
+    ///   `nil`, an all zeroes IV will be used.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` to indicate an invalid IV.
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    ///   - Any error thrown by `body`.
+    public func withCryptor<Return>(iv: UnsafePointer<Void> = nil, @noescape body: Cryptor throws -> Return) throws -> Return {
+        let reusable = configuration.mode.isResettable
+        let cryptor: Cryptor
+        if reusable, let found: Cryptor = lock.withLock({ idle.isEmpty ? nil : idle.removeLast() }) {
+            try found.reset(iv)
+            cryptor = found
+        } else {
+            let c = configuration
+            cryptor = try Cryptor(operation: operation.rawValue, configuration: Cryptor.Configuration(mode: c.mode, algorithm: c.algorithm, padding: c.padding, iv: iv, tweak: c.tweak, numberOfRounds: c.numberOfRounds), key: key.buffer)
+        }
+        
+        defer {
+            let evicted: Cryptor? = lock.withLock {
+                guard reusable && idle.count < maximumIdleCount else { return cryptor }
+                idle.append(cryptor)
+                return nil
+            }
+            // Release any surplus cryptor outside the lock.
+            withExtendedLifetime(evicted) {}
+        }
+        return try body(cryptor)
+    }
+    
+    /// One-shot encryption or decryption with a new IV.
+    ///
+    /// - parameter iv: The initialization vector, if the mode uses one.
+    /// - seealso: Cryptor.encryptWithAlgorithm(algorithm:key:input:output:)
+    public func crypt(iv iv: UnsafePointer<Void> = nil, input: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        let needed = outputLength(forInput: input.count)
+        guard output.count >= needed else {
+            throw Cryptor.OneShotError.BufferTooSmall(needed)
+        }
+        return try withCryptor(iv) {
+            try Cryptor.cryptWithCryptor($0.rawPointer, needed: needed, input: input, output: &output)
+        }
+    }
+    
+    /// Output buffer size, in bytes, required by `crypt` for `inputLength`
+    /// bytes.
+    public func outputLength(forInput inputLength: Int) -> Int {
+        switch (configuration.mode, configuration.padding, operation) {
+        case (.ECB, .PKCS7, .Encrypt), (.CBC, .PKCS7, .Encrypt):
+            return (inputLength / blockSize + 1) * blockSize
+        default:
+            return inputLength
+        }
+    }
+    
+}
+
+/// A memory-bounded cache of prepared keys, for services that use the same
+/// few thousand keys over and over.
+///
+/// Keys are found by a hash of their configuration and raw key material,
+/// then confirmed by comparing in constant time. When the cache holds more
+/// than `capacity` keys, the least recently used eighth are evicted; an
+/// evicted key's cryptors are released and its key material wiped as soon
+/// as no caller is using it.
+///
+/// A `PreparedKeyCache` can be used from multiple threads at the same time.
+public final class PreparedKeyCache {
+    
+    private final class Entry {
+        let key: PreparedKey
+        var lastUse: UInt64
+        
+        init(key: PreparedKey, lastUse: UInt64) {
+            self.key = key
+            self.lastUse = lastUse
+        }
+    }
+    
+    /// The maximum number of prepared keys retained.
+    public let capacity: Int
+    /// The number of idle cryptors retained by each prepared key.
+    public let maximumIdleCount: Int
+    
+    private let lock = Mutex()
+    private var buckets = [Int: [Entry]]()
+    private var count = 0
+    private var clock: UInt64 = 0
+    
+    /// Create an empty cache.
+    ///
+    /// - parameter capacity: The maximum number of prepared keys to retain.
+    ///   Each holds up to `maximumIdleCount` cryptors.
+    /// - parameter maximumIdleCount: The number of idle cryptors to retain
+    ///   for each key.
+    public init(capacity: Int = 4096, maximumIdleCount: Int = 2) {
+        self.capacity = max(capacity, 1)
+        self.maximumIdleCount = maximumIdleCount
+    }
+    
+    private func preparedKey(operation op: Cryptor.Operation, algorithm alg: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>) throws -> PreparedKey {
+        let c = Cryptor.Configuration(alg)
+        let hash = c.hash(operation: op.rawValue, key: key)
+        
+        let found: PreparedKey? = lock.withLock {
+            guard let entries = buckets[hash], index = entries.indexOf({ $0.key.matches(operation: op, configuration: c, key: key) }) else { return nil }
+            let entry = entries[index]
+            clock += 1
+            entry.lastUse = clock
+            return entry.key
+        }
+        if let key = found {
+            return key
+        }
+        
+        // Prepare outside the lock; if another thread raced to prepare the
+        // same key, both are usable and only the first is cached.
+        let prepared = try PreparedKey(operation: op, algorithm: alg, configuration: c, key: key, maximumIdleCount: maximumIdleCount)
+        let evicted: [Entry] = lock.withLock {
+            var entries = buckets[hash] ?? []
+            if let index = entries.indexOf({ $0.key.matches(operation: op, configuration: c, key: key) }) {
+                clock += 1
+                entries[index].lastUse = clock
+                return []
+            }
+            
+            clock += 1
+            entries.append(Entry(key: prepared, lastUse: clock))
+            buckets[hash] = entries
+            count += 1
+            return count > capacity ? evictLeastRecentlyUsed() : []
+        }
+        // Release evicted keys outside the lock.
+        withExtendedLifetime(evicted) {}
+        return prepared
+    }
+    
+    /// Remove the least recently used eighth of the cache. Must be called
+    /// with the lock held.
+    private func evictLeastRecentlyUsed() -> [Entry] {
+        let all = buckets.values.flatMap { $0 }.sort { $0.lastUse < $1.lastUse }
+        let evicted = Array(all.prefix(max(capacity / 8, 1)))
+        let cutoff = evicted.last?.lastUse ?? 0
+        for (hash, entries) in buckets {
+            let kept = entries.filter { $0.lastUse > cutoff }
+            buckets[hash] = kept.isEmpty ? nil : kept
+        }
+        count -= evicted.count
+        return evicted
+    }
+    
+    /// Find or prepare a key for encryption.
+    ///
+    /// - seealso: PreparedKey.init(forEncryption:key:maximumIdleCount:)
+    public func preparedKey(forEncryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>) throws -> PreparedKey {
+        return try preparedKey(operation: .Encrypt, algorithm: algorithm, key: key)
+    }
+    
+    /// Find or prepare a key for decryption.
+    ///
+    /// - seealso: PreparedKey.init(forDecryption:key:maximumIdleCount:)
+    public func preparedKey(forDecryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>) throws -> PreparedKey {
+        return try preparedKey(operation: .Decrypt, algorithm: algorithm, key: key)
+    }
+    
+    /// Release every prepared key held by the cache.
+    public func removeAll() {
+        let evicted: [Int: [Entry]] = lock.withLock {
+            defer {
+                buckets.removeAll()
+                count = 0
+            }
+            return buckets
+        }
+        withExtendedLifetime(evicted) {}
+    }
+    
+}
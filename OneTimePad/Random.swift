@@ -7,6 +7,7 @@
 //
 
 import CommonCryptoShim.Private
+import Darwin
 
 /// A collection that may be accessed efficiently in a contiguous manner from C.
 public protocol BufferType: RangeReplaceableCollectionType {
@@ -27,6 +28,10 @@ public protocol BufferType: RangeReplaceableCollectionType {
     ///   correct value. Instead, use only the buffer passed to `body`.
     mutating func withUnsafeMutableBufferPointer(@noescape body: (inout UnsafeMutableBufferPointer<Generator.Element>) throws -> ()) rethrows
     
+    /// Call `body(p)`, where `p` is a pointer to the type's contiguous
+    /// storage. If no such storage exists, it is first created.
+    func withUnsafeBufferPointer(@noescape body: UnsafeBufferPointer<Generator.Element> throws -> ()) rethrows
+    
 }
 
 public extension BufferType where Generator.Element: IntegerType {
@@ -35,11 +40,47 @@ public extension BufferType where Generator.Element: IntegerType {
     /// value `repeatedValue`.
     public init(count: Index.Distance, repeatedValue: Generator.Element) {
         self.init()
+        reserveCapacity(count)
         appendContentsOf(Repeat(count: numericCast(count), repeatedValue: repeatedValue))
     }
     
 }
 
+public extension BufferType where Generator.Element: IntegerType {
+    
+    /// Compare the contents of two buffers in time that depends only on their
+    /// length, not on where they differ.
+    ///
+    /// The buffers are compared in place, a machine word at a time. Use this,
+    /// rather than `==`, to verify MACs and other secrets.
+    ///
+    /// - parameter other: The buffer to compare to. If its length differs,
+    ///   the result is `false`; lengths are not considered secret.
+    func constantTimeEquals<Other: BufferType where Other.Generator.Element == Generator.Element>(other: Other) -> Bool {
+        guard numericCast(count) as Int == numericCast(other.count) as Int else { return false }
+        
+        var result = false
+        withUnsafeBufferPointer { lhs in
+            other.withUnsafeBufferPointer { rhs in
+                result = OneTimePad.constantTimeEquals(lhs.baseAddress, rhs.baseAddress, count: lhs.count * sizeof(Generator.Element))
+            }
+        }
+        return result
+    }
+    
+    /// Overwrite the contents of the buffer with zeroes, in place.
+    ///
+    /// Unlike assigning zeroes element by element, the write cannot be
+    /// optimized away, even if the buffer is never read again. Use this to
+    /// wipe keys and other secrets.
+    mutating func secureZero() {
+        withUnsafeMutableBufferPointer { buffer in
+            OneTimePad.secureZero(buffer.baseAddress, count: buffer.count * sizeof(Generator.Element))
+        }
+    }
+    
+}
+
 extension Array: BufferType {}
 extension ArraySlice: BufferType {}
 extension ContiguousArray: BufferType {}
@@ -67,8 +108,17 @@ public extension BufferType where Generator.Element: IntegerType {
     ///   - `CryptoError.RNGFailure` if the source of random numbers could not
     ///   produce cryptographically-strong random data.
     init(randomCount count: Index.Distance) throws {
-        self.init(count: count, repeatedValue: Element.allZeros)
-        try fillWithRandomData()
+        // The standard library has no way to hand out reserved but
+        // uninitialized storage, so the elements are zeroed once, in bulk,
+        // before being overwritten in place by a single call to the
+        // generator. No scratch buffer or copy is involved.
+        self.init(count: count, repeatedValue: 0)
+        do {
+            try fillWithRandomData()
+        } catch {
+            removeAll()
+            throw error
+        }
     }
     
 }
@@ -0,0 +1,135 @@
+//
+//  RandomPool.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Darwin
+
+/// A buffered front-end to the system random number generator for small
+/// requests, such as nonces and IVs.
+///
+/// Each thread has its own buffer, refilled from `CCRandomGenerateBytes`
+/// `bufferSize` bytes at a time. Small requests are served by copying out of
+/// that buffer, without taking a lock or entering the kernel. Bytes are
+/// wiped from the buffer as they are handed out, so no random data is ever
+/// served twice or left behind in memory; the buffer is wiped when its
+/// thread exits.
+///
+/// After a `fork`, the child discards every buffer inherited from the parent
+/// before serving any request, so parent and child never share output.
+public enum RandomPool {
+    
+    /// The number of bytes generated by each refill of a thread's buffer.
+    public static let bufferSize = 16 * 1024
+    
+    /// Requests larger than this many bytes bypass the buffer and call the
+    /// system generator directly.
+    public static let maximumBufferedCount = 256
+    
+    /// Incremented in the child process after every `fork`.
+    private static var forkGeneration: UInt = 0
+    
+    private static let key: pthread_key_t = {
+        var key = pthread_key_t()
+        pthread_key_create(&key) {
+            Unmanaged<RandomBuffer>.fromOpaque(COpaquePointer($0)).release()
+        }
+        pthread_atfork(nil, nil) {
+            RandomPool.forkGeneration = RandomPool.forkGeneration &+ 1
+        }
+        return key
+    }()
+    
+    private static var current: RandomBuffer {
+        let existing = pthread_getspecific(key)
+        if existing != nil {
+            return Unmanaged<RandomBuffer>.fromOpaque(COpaquePointer(existing)).takeUnretainedValue()
+        }
+        
+        let buffer = RandomBuffer()
+        pthread_setspecific(key, UnsafePointer(Unmanaged.passRetained(buffer).toOpaque()))
+        return buffer
+    }
+    
+    /// Fill a pre-allocated buffer with random bytes.
+    ///
+    /// The random number generator, provided by the hardware or platform, can
+    /// create cryptographically strong random data suitable for use as
+    /// cryptographic keys, IVs, nonces etc.
+    ///
+    /// - parameter output: The memory to fill.
+    /// - throws:
+    ///   - `CryptoError.RNGFailure` if the source of random numbers could not
+    ///   produce cryptographically-strong random data.
+    public static func fill(output: UnsafeMutableBufferPointer<Void>) throws {
+        guard output.count <= maximumBufferedCount else {
+            try cc_call {
+                CCRandomGenerateBytes(output.baseAddress, output.count)
+            }
+            return
+        }
+        
+        try current.take(output)
+    }
+    
+}
+
+private final class RandomBuffer {
+    
+    private let bytes = UnsafeMutablePointer<UInt8>.alloc(RandomPool.bufferSize)
+    /// Bytes before this offset have been handed out and wiped.
+    private var offset = RandomPool.bufferSize
+    private var generation = RandomPool.forkGeneration
+    
+    deinit {
+        secureZero(bytes, count: RandomPool.bufferSize)
+        bytes.dealloc(RandomPool.bufferSize)
+    }
+    
+    private func refill() throws {
+        offset = RandomPool.bufferSize
+        secureZero(bytes, count: RandomPool.bufferSize)
+        try cc_call {
+            CCRandomGenerateBytes(bytes, RandomPool.bufferSize)
+        }
+        offset = 0
+        generation = RandomPool.forkGeneration
+    }
+    
+    func take(output: UnsafeMutableBufferPointer<Void>) throws {
+        if generation != RandomPool.forkGeneration || RandomPool.bufferSize - offset < output.count {
+            try refill()
+        }
+        
+        memcpy(output.baseAddress, bytes + offset, output.count)
+        secureZero(bytes + offset, count: output.count)
+        offset += output.count
+    }
+    
+}
+
+public extension MutableCollectionType where SubSequence: BufferType, SubSequence.Generator.Element: IntegerType {
+    
+    /// Fill a pre-allocated buffer with random bytes from the `RandomPool`.
+    ///
+    /// This is faster than `fillWithRandomData` for small buffers, such as
+    /// nonces and IVs.
+    ///
+    /// - parameter range: Optional sub-range to fill with data. If not
+    ///   provided, the entire contents of the collection will be replaced.
+    /// - throws:
+    ///   - `CryptoError.RNGFailure` if the source of random numbers could not
+    ///   produce cryptographically-strong random data.
+    mutating func fillWithPooledRandomData(inRange range: Range<Index>? = nil) throws {
+        let range = range ?? indices
+        try self[range].withUnsafeMutableBufferPointer { buffer in
+            let byteCount = sizeof(SubSequence.Generator.Element) * numericCast(buffer.count)
+            try RandomPool.fill(UnsafeMutableBufferPointer(start: buffer.baseAddress, count: byteCount))
+        }
+    }
+    
+}
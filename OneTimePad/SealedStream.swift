@@ -0,0 +1,232 @@
+//
+//  SealedStream.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// Authenticated encryption built from a `Cryptor` and an `HMAC`, in the
+/// encrypt-then-MAC construction, for algorithms other than GCM.
+///
+/// When sealing, each chunk of ciphertext is fed to the HMAC directly from
+/// the output buffer the moment `update` produces it, while it is still in
+/// cache; no second pass is made over the output. `finalize` appends the tag
+/// after the last of the ciphertext.
+///
+/// The MAC covers the length of the authenticated data as a 64-bit
+/// big-endian integer, the authenticated data, the ciphertext, and the
+/// length of the ciphertext, so that no bytes can be moved between the
+/// authenticated data and the ciphertext.
+///
+/// When opening, the input is the ciphertext followed by the tag. The last
+/// `tagLength` bytes seen are held back until `finalize`, which verifies
+/// the tag in constant time before finalizing the cryptor. Plaintext is
+/// produced as the input streams, so it must not be trusted or acted upon
+/// until `finalize` returns successfully.
+///
+/// The encryption and MAC keys must be independent.
+public final class SealedStream {
+    
+    /// The direction of this stream.
+    public let operation: Cryptor.Operation
+    private let cryptor: Cryptor
+    private var hmac: HMAC
+    /// When opening, the most recent input, which may be the tag.
+    private var pending = [UInt8]()
+    /// The number of bytes of ciphertext authenticated so far.
+    private var ciphertextLength: UInt64 = 0
+    
+    private init(operation: Cryptor.Operation, algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, macAlgorithm: Digest.Algorithm, macKey: UnsafeBufferPointer<Void>, authenticatedData: UnsafeBufferPointer<Void>) throws {
+        self.operation = operation
+        switch operation {
+        case .Encrypt:
+            cryptor = try Cryptor(forEncryption: algorithm, key: key)
+        case .Decrypt:
+            cryptor = try Cryptor(forDecryption: algorithm, key: key)
+        }
+        hmac = HMAC(algorithm: macAlgorithm, key: macKey)
+        authenticateLength(UInt64(authenticatedData.count))
+        hmac.update(authenticatedData)
+        pending.reserveCapacity(macAlgorithm.digestLength)
+    }
+    
+    /// Create a stream that encrypts and appends a tag.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material for `algorithm`.
+    /// - parameter macAlgorithm: The digest algorithm for the HMAC.
+    /// - parameter macKey: Raw key material for the HMAC.
+    /// - parameter authenticatedData: Data to authenticate, but not encrypt,
+    ///   such as the IV and a header. It must be provided identically when
+    ///   opening.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forEncryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, macAlgorithm: Digest.Algorithm = .SHA256, macKey: UnsafeBufferPointer<Void>, authenticatedData: UnsafeBufferPointer<Void> = UnsafeBufferPointer(start: nil, count: 0)) throws {
+        try self.init(operation: .Encrypt, algorithm: algorithm, key: key, macAlgorithm: macAlgorithm, macKey: macKey, authenticatedData: authenticatedData)
+    }
+    
+    /// Create a stream that verifies a trailing tag and decrypts.
+    ///
+    /// - parameter algorithm: Defines the algorithm and its mode.
+    /// - parameter key: Raw key material for `algorithm`.
+    /// - parameter macAlgorithm: The digest algorithm for the HMAC.
+    /// - parameter macKey: Raw key material for the HMAC.
+    /// - parameter authenticatedData: The data authenticated when sealing.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forDecryption algorithm: Cryptor.Algorithm, key: UnsafeBufferPointer<Void>, macAlgorithm: Digest.Algorithm = .SHA256, macKey: UnsafeBufferPointer<Void>, authenticatedData: UnsafeBufferPointer<Void> = UnsafeBufferPointer(start: nil, count: 0)) throws {
+        try self.init(operation: .Decrypt, algorithm: algorithm, key: key, macAlgorithm: macAlgorithm, macKey: macKey, authenticatedData: authenticatedData)
+    }
+    
+    deinit {
+        pending.secureZero()
+    }
+    
+    /// The length of the tag, in bytes.
+    public var tagLength: Int {
+        return hmac.algorithm.digestLength
+    }
+    
+    /// Determine output buffer size required to process a given input size.
+    ///
+    /// - seealso: Cryptor.outputLengthForInputLength(_:finalizing:)
+    public func outputLengthForInputLength(inputLength: Int, finalizing: Bool = false) -> Int {
+        switch operation {
+        case .Encrypt:
+            return cryptor.outputLengthForInputLength(inputLength, finalizing: finalizing) + (finalizing ? tagLength : 0)
+        case .Decrypt:
+            return cryptor.outputLengthForInputLength(inputLength + pending.count, finalizing: finalizing)
+        }
+    }
+    
+    /// Feed a length to the HMAC as a 64-bit big-endian integer.
+    private func authenticateLength(length: UInt64) {
+        var bytes = [UInt8]()
+        bytes.reserveCapacity(8)
+        for shift in (0 ..< 8).reverse() {
+            bytes.append(UInt8(truncatingBitPattern: length >> UInt64(shift * 8)))
+        }
+        bytes.withUnsafeBufferPointer {
+            self.hmac.update(UnsafeBufferPointer(start: $0.baseAddress, count: $0.count))
+        }
+    }
+    
+    /// Feed ciphertext to the HMAC.
+    private func authenticateCiphertext(data: UnsafeBufferPointer<Void>) {
+        hmac.update(data)
+        ciphertextLength += UInt64(data.count)
+    }
+    
+    /// Decrypt ciphertext, authenticating it only once the cryptor has
+    /// accepted it, so that a retry after an error does not feed it twice.
+    private func open(data: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard data.count > 0 else { return 0 }
+        var out: UnsafeMutableBufferPointer<Void>! = output
+        let written = try cryptor.update(data, output: &out)
+        authenticateCiphertext(data)
+        return written
+    }
+    
+    /// Process (seal or open) some data. The result, if any, is written to a
+    /// caller-provided buffer.
+    ///
+    /// This method can be called multiple times.
+    ///
+    /// - parameter data: Data to process. When opening, the tag is expected
+    ///   as the last `tagLength` bytes of all the data provided.
+    /// - parameter output: The result, if any, is written here. Must be
+    ///   allocated by the caller; see `outputLengthForInputLength`. When
+    ///   sealing, the same buffer can be used for input and output. When
+    ///   opening, the input and output must not overlap.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - Any error thrown by `Cryptor.update`.
+    public func update(data: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        switch operation {
+        case .Encrypt:
+            var out: UnsafeMutableBufferPointer<Void>! = output
+            let written = try cryptor.update(data, output: &out)
+            authenticateCiphertext(UnsafeBufferPointer(start: output.baseAddress, count: written))
+            return written
+        case .Decrypt:
+            // Everything but the last `tagLength` bytes seen so far is
+            // ciphertext; process it from the held-back bytes, then from
+            // `data` directly. Held-back bytes are dropped as soon as they
+            // are consumed, so if either step throws, calling again with
+            // the same `data` picks up where this call left off.
+            let release = max(pending.count + data.count - tagLength, 0)
+            let fromPending = min(release, pending.count)
+            let fromData = release - fromPending
+            
+            let written = try pending.withUnsafeBufferPointer {
+                try self.open(UnsafeBufferPointer(start: $0.baseAddress, count: fromPending), output: output)
+            }
+            pending.removeRange(0 ..< fromPending)
+            
+            let bytes = UnsafePointer<UInt8>(data.baseAddress)
+            let rest = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer<UInt8>(output.baseAddress) + written, count: output.count - written)
+            let total = written + (try open(UnsafeBufferPointer(start: bytes, count: fromData), output: rest))
+            
+            pending.appendContentsOf(UnsafeBufferPointer(start: bytes + fromData, count: data.count - fromData))
+            return total
+        }
+    }
+    
+    /// Finish the stream.
+    ///
+    /// When sealing, any remaining ciphertext is written, followed by the
+    /// tag. When opening, the tag is verified, then any remaining plaintext
+    /// is written.
+    ///
+    /// - parameter output: The result is written here. Must be allocated by
+    ///   the caller; see `outputLengthForInputLength`.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.DecodingFailure` when opening, if the tag is missing
+    ///     or does not match, indicating tampered data or the wrong keys. All
+    ///     output produced by `update` must be discarded.
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer. No state has been lost.
+    ///   - Any error thrown by `Cryptor.finalize`.
+    public func finalize(output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        // The HMAC cannot be rewound, so check the space up front.
+        let needed = cryptor.outputLengthForInputLength(0, finalizing: true) + (operation == .Encrypt ? tagLength : 0)
+        guard output.count >= needed else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        switch operation {
+        case .Encrypt:
+            var out = output
+            let written = try cryptor.finalize(&out)
+            authenticateCiphertext(UnsafeBufferPointer(start: output.baseAddress, count: written))
+            authenticateLength(ciphertextLength)
+            var tag = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer<UInt8>(output.baseAddress) + written, count: output.count - written)
+            return written + (try hmac.finalize(&tag))
+        case .Decrypt:
+            guard pending.count == tagLength else {
+                throw CryptoError.DecodingFailure
+            }
+            
+            authenticateLength(ciphertextLength)
+            var computed = [UInt8](count: tagLength, repeatedValue: 0)
+            defer { computed.secureZero() }
+            try computed.withUnsafeMutableBufferPointer { (inout buffer: UnsafeMutableBufferPointer<UInt8>) in
+                var tag = UnsafeMutableBufferPointer<Void>(start: UnsafeMutablePointer(buffer.baseAddress), count: buffer.count)
+                try self.hmac.finalize(&tag)
+            }
+            guard computed.constantTimeEquals(pending) else {
+                throw CryptoError.DecodingFailure
+            }
+            
+            var out = output
+            return try cryptor.finalize(&out)
+        }
+    }
+    
+}
@@ -0,0 +1,214 @@
+//
+//  TreeDigest.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+
+/// A Merkle tree hash over the message digest algorithms in CommonCrypto.
+///
+/// The input is split into fixed-size leaves, which are hashed concurrently.
+/// Pairs of hashes are then combined, level by level, until a single root
+/// remains; an unpaired hash at the end of a level is carried up unchanged.
+/// Leaf and interior hashes are domain-separated:
+///
+///     leaf     = H(0x00 || data)
+///     interior = H(0x01 || left || right)
+///
+/// The root is therefore a distinct hash from the plain digest of the same
+/// data, even when the input fits in a single leaf, and it is only
+/// comparable between trees with the same algorithm and leaf size.
+///
+/// A `TreeDigest` keeps the hash of every leaf. After part of the data
+/// changes, only the leaves overlapping the changed range are re-hashed;
+/// recomputing the root from the leaves is cheap by comparison.
+public struct TreeDigest {
+    
+    private static let leafPrefix: [UInt8] = [ 0x00 ]
+    private static let interiorPrefix: [UInt8] = [ 0x01 ]
+    
+    /// The underlying digest algorithm.
+    public let algorithm: Digest.Algorithm
+    /// The number of bytes of input covered by each leaf.
+    public let leafSize: Int
+    /// The length of the data hashed so far.
+    public private(set) var length = 0
+    /// The leaf hashes, back-to-back; the hash for leaf `i` begins at byte
+    /// offset `i * algorithm.digestLength`.
+    public private(set) var leaves = [UInt8]()
+    
+    /// Create an empty tree.
+    ///
+    /// - parameter algorithm: Defines the underlying digest algorithm.
+    /// - parameter leafSize: The number of bytes of input in each leaf,
+    ///   greater than zero. Should be large enough to amortize dispatching
+    ///   work to another core.
+    public init(algorithm: Digest.Algorithm = .SHA256, leafSize: Int = 1024 * 1024) {
+        self.algorithm = algorithm
+        self.leafSize = max(leafSize, 1)
+    }
+    
+    /// The number of leaves in the tree. Empty data has a single, empty leaf.
+    public var leafCount: Int {
+        return max((length + leafSize - 1) / leafSize, 1)
+    }
+    
+    /// The byte range of the input covered by the leaf at `index`.
+    public func rangeOfLeaf(index: Int) -> Range<Int> {
+        let start = index * leafSize
+        return start ..< min(start + leafSize, length)
+    }
+    
+    /// The hash of the leaf at `index`.
+    public func hashOfLeaf(index: Int) -> ArraySlice<UInt8> {
+        let digestLength = algorithm.digestLength
+        return leaves[index * digestLength ..< (index + 1) * digestLength]
+    }
+    
+    private static func hash(algorithm: Digest.Algorithm, prefix: [UInt8], parts: [UnsafeBufferPointer<Void>], output: UnsafeMutablePointer<UInt8>) {
+        var digest = Digest(algorithm: algorithm)
+        prefix.withUnsafeBufferPointer {
+            digest.update(UnsafeBufferPointer(start: $0.baseAddress, count: $0.count))
+        }
+        for part in parts {
+            digest.update(part)
+        }
+        var out = UnsafeMutableBufferPointer<Void>(start: output, count: algorithm.digestLength)
+        // Cannot fail; `out` is exactly the digest length.
+        _ = try? digest.finalize(&out)
+    }
+    
+    /// Hash the leaves at `indexes` from `data` into `leaves`.
+    private mutating func hashLeaves(indexes: Range<Int>, data: UnsafeBufferPointer<Void>, queue: dispatch_queue_t) {
+        guard !indexes.isEmpty else { return }
+        
+        let algorithm = self.algorithm
+        let digestLength = algorithm.digestLength
+        let ranges = indexes.map { rangeOfLeaf($0) }
+        let first = indexes.startIndex
+        leaves.withUnsafeMutableBufferPointer { (inout leaves: UnsafeMutableBufferPointer<UInt8>) in
+            let leaves = leaves.baseAddress
+            dispatch_apply(ranges.count, queue) { index in
+                let range = ranges[index]
+                let leaf = UnsafeBufferPointer<Void>(start: UnsafePointer<UInt8>(data.baseAddress) + range.startIndex, count: range.count)
+                TreeDigest.hash(algorithm, prefix: TreeDigest.leafPrefix, parts: [ leaf ], output: leaves + (first + index) * digestLength)
+            }
+        }
+    }
+    
+    /// Hash complete data, replacing any existing leaves.
+    ///
+    /// - parameter data: Data to hash.
+    /// - parameter queue: The queue on which leaves are hashed; should be
+    ///   concurrent.
+    public mutating func update(data: UnsafeBufferPointer<Void>, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) {
+        length = data.count
+        leaves = [UInt8](count: leafCount * algorithm.digestLength, repeatedValue: 0)
+        hashLeaves(0 ..< leafCount, data: data, queue: queue)
+    }
+    
+    /// Re-hash only the leaves affected by a change to the data.
+    ///
+    /// Leaves overlapping `changedRange` are re-hashed, as are any leaves
+    /// added or shortened by a change in length; all others are kept.
+    ///
+    /// - parameter data: The complete, updated data.
+    /// - parameter changedRange: The byte range of `data` that differs from
+    ///   the data previously hashed.
+    /// - parameter queue: The queue on which leaves are hashed; should be
+    ///   concurrent.
+    /// - returns: The indexes of the leaves that were re-hashed.
+    public mutating func update(data: UnsafeBufferPointer<Void>, changedRange: Range<Int>, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) -> Range<Int> {
+        guard !leaves.isEmpty else {
+            update(data, queue: queue)
+            return 0 ..< leafCount
+        }
+        
+        let digestLength = algorithm.digestLength
+        let oldLength = length
+        let oldCount = leafCount
+        length = data.count
+        let newCount = leafCount
+        
+        if newCount > oldCount {
+            leaves.appendContentsOf(Repeat(count: (newCount - oldCount) * digestLength, repeatedValue: 0))
+        } else if newCount < oldCount {
+            leaves.removeRange(newCount * digestLength ..< leaves.count)
+        }
+        
+        // Any leaf past the shorter of the two lengths has changed size.
+        var start = min(oldLength, length) / leafSize
+        var end = newCount
+        let changed = min(changedRange.startIndex, length) ..< min(changedRange.endIndex, length)
+        if !changed.isEmpty {
+            start = min(start, changed.startIndex / leafSize)
+        } else if oldLength == length {
+            return 0 ..< 0
+        }
+        if oldLength == length {
+            end = (changed.endIndex - 1) / leafSize + 1
+        }
+        
+        let indexes = min(start, newCount - 1) ..< end
+        hashLeaves(indexes, data: data, queue: queue)
+        return indexes
+    }
+    
+    /// Obtain the root hash of the tree.
+    ///
+    /// - parameter output: The root is written here. Must be allocated by the
+    ///   caller, with space for at least `algorithm.digestLength` bytes.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    public func root(inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        let digestLength = algorithm.digestLength
+        guard output.count >= digestLength else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        var level = leaves.isEmpty ? [UInt8](count: digestLength, repeatedValue: 0) : leaves
+        if leaves.isEmpty {
+            level.withUnsafeMutableBufferPointer { (inout level: UnsafeMutableBufferPointer<UInt8>) in
+                TreeDigest.hash(algorithm, prefix: TreeDigest.leafPrefix, parts: [], output: level.baseAddress)
+            }
+        }
+        
+        var count = level.count / digestLength
+        level.withUnsafeMutableBufferPointer { (inout level: UnsafeMutableBufferPointer<UInt8>) in
+            // Each level is written over the front of the one below it.
+            let nodes = level.baseAddress
+            while count > 1 {
+                for index in 0 ..< count / 2 {
+                    let pair = UnsafeBufferPointer<Void>(start: nodes + 2 * index * digestLength, count: 2 * digestLength)
+                    TreeDigest.hash(algorithm, prefix: TreeDigest.interiorPrefix, parts: [ pair ], output: nodes + index * digestLength)
+                }
+                if count % 2 == 1 {
+                    (nodes + (count / 2) * digestLength).assignFrom(nodes + (count - 1) * digestLength, count: digestLength)
+                }
+                count = (count + 1) / 2
+            }
+            UnsafeMutablePointer<UInt8>(output.baseAddress).assignFrom(nodes, count: digestLength)
+        }
+        return digestLength
+    }
+    
+    /// Check a single leaf of data against the stored hash, in constant time.
+    ///
+    /// - parameter data: The data of the leaf; see `rangeOfLeaf`.
+    /// - parameter index: The index of the leaf.
+    public func verifyLeaf(data: UnsafeBufferPointer<Void>, atIndex index: Int) -> Bool {
+        guard index < leafCount else { return false }
+        var computed = [UInt8](count: algorithm.digestLength, repeatedValue: 0)
+        computed.withUnsafeMutableBufferPointer { (inout computed: UnsafeMutableBufferPointer<UInt8>) in
+            TreeDigest.hash(algorithm, prefix: TreeDigest.leafPrefix, parts: [ data ], output: computed.baseAddress)
+        }
+        return computed.constantTimeEquals(hashOfLeaf(index))
+    }
+    
+}
@@ -0,0 +1,253 @@
+//
+//  TypedCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+
+/// A block cipher, described entirely by static properties.
+///
+/// The conforming types are caseless enums used only as generic arguments
+/// to `TypedCryptor`; their properties are compile-time constants.
+public protocol BlockCipherType {
+    /// The CommonCrypto identifier of the algorithm.
+    static var identifier: UInt32 { get }
+    /// Block size, in bytes.
+    static var blockSize: Int { get }
+    /// The range of supported key sizes, in bytes.
+    static var validKeySizes: ClosedInterval<Int> { get }
+    /// Whether `count` is a supported key size, in bytes.
+    static func isValidKeySize(count: Int) -> Bool
+}
+
+public extension BlockCipherType {
+    
+    static func isValidKeySize(count: Int) -> Bool {
+        return validKeySizes.contains(count)
+    }
+    
+}
+
+/// A block cipher mode of operation, described entirely by static
+/// properties.
+///
+/// The conforming types are caseless enums used only as generic arguments
+/// to `TypedCryptor`; their properties are compile-time constants.
+public protocol BlockCipherModeType {
+    /// The CommonCrypto identifier of the mode.
+    static var identifier: UInt32 { get }
+    /// Whether the mode takes an initialization vector.
+    static var usesIV: Bool { get }
+    /// Whether the mode supports padding; if not, the output is always the
+    /// same length as the input.
+    static var supportsPadding: Bool { get }
+}
+
+/// Advanced Encryption Standard, 128-bit block.
+public enum AES: BlockCipherType {
+    public static let identifier = CCAlgorithm.AES.rawValue
+    public static let blockSize = kCCBlockSizeAES128
+    public static let validKeySizes = kCCKeySizeAES128...kCCKeySizeAES256
+    
+    /// AES has three discrete key sizes in 64-bit increments.
+    public static func isValidKeySize(count: Int) -> Bool {
+        return count == kCCKeySizeAES128 || count == kCCKeySizeAES192 || count == kCCKeySizeAES256
+    }
+}
+
+/// Data Encryption Standard.
+public enum DES: BlockCipherType {
+    public static let identifier = CCAlgorithm.DES.rawValue
+    public static let blockSize = kCCBlockSizeDES
+    public static let validKeySizes = kCCKeySizeDES...kCCKeySizeDES
+}
+
+/// Triple-DES, three key, EDE configuration.
+public enum TripleDES: BlockCipherType {
+    public static let identifier = CCAlgorithm.TripleDES.rawValue
+    public static let blockSize = kCCBlockSize3DES
+    public static let validKeySizes = kCCKeySize3DES...kCCKeySize3DES
+}
+
+/// CAST.
+public enum CAST: BlockCipherType {
+    public static let identifier = CCAlgorithm.CAST.rawValue
+    public static let blockSize = kCCBlockSizeCAST
+    public static let validKeySizes = kCCKeySizeMinCAST...kCCKeySizeMaxCAST
+}
+
+/// Blowfish block cipher.
+public enum Blowfish: BlockCipherType {
+    public static let identifier = CCAlgorithm.Blowfish.rawValue
+    public static let blockSize = kCCBlockSizeBlowfish
+    public static let validKeySizes = kCCKeySizeMinBlowfish...kCCKeySizeMaxBlowfish
+}
+
+/// Electronic Code Book Mode.
+public enum ECB: BlockCipherModeType {
+    public static let identifier = CCMode.ECB.rawValue
+    public static let usesIV = false
+    public static let supportsPadding = true
+}
+
+/// Cipher Block Chaining Mode.
+public enum CBC: BlockCipherModeType {
+    public static let identifier = CCMode.CBC.rawValue
+    public static let usesIV = true
+    public static let supportsPadding = true
+}
+
+/// Cipher Feedback Mode.
+public enum CFB: BlockCipherModeType {
+    public static let identifier = CCMode.CFB.rawValue
+    public static let usesIV = true
+    public static let supportsPadding = false
+}
+
+/// Counter Mode.
+public enum CTR: BlockCipherModeType {
+    public static let identifier = CCMode.CTR.rawValue
+    public static let usesIV = true
+    public static let supportsPadding = false
+}
+
+/// Output Feedback Mode.
+public enum OFB: BlockCipherModeType {
+    public static let identifier = CCMode.OFB.rawValue
+    public static let usesIV = true
+    public static let supportsPadding = false
+}
+
+/// A symmetric cryptor whose algorithm and mode are fixed at compile time,
+/// such as `TypedCryptor<AES, CBC>`.
+///
+/// Unlike `Cryptor`, which switches over `Cryptor.Algorithm` and
+/// `Cryptor.Mode` at runtime, a `TypedCryptor` reads its block size, key
+/// sizes, and mode from its generic arguments, so the compiler specializes
+/// each variant and the checks on its hot path fold to constants. The key
+/// and IV are validated against those constants when the context is created.
+///
+/// The general operation matches `Cryptor`: `update` one or more times,
+/// `finalize`, then optionally `reset` for reuse with the same key.
+///
+/// A given `TypedCryptor` can only be used by one thread at a time.
+public final class TypedCryptor<Cipher: BlockCipherType, Mode: BlockCipherModeType>: CCPointer {
+    
+    /// Block size, in bytes.
+    public static var blockSize: Int {
+        return Cipher.blockSize
+    }
+    
+    /// The length of the initialization vector, in bytes; zero if the mode
+    /// does not take one.
+    public static var ivLength: Int {
+        return Mode.usesIV ? Cipher.blockSize : 0
+    }
+    
+    /// The direction of this context.
+    public let operation: Cryptor.Operation
+    /// The padding used by this context.
+    public let padding: Cryptor.Padding
+    private(set) var rawPointer = Cryptor.RawCryptor()
+    
+    /// The IV to give CommonCrypto: `nil` if the mode does not take one,
+    /// whatever was passed.
+    private static func validatedIV(iv: UnsafeBufferPointer<Void>?) throws -> UnsafePointer<Void> {
+        guard Mode.usesIV, let iv = iv else { return nil }
+        guard iv.count == ivLength else {
+            throw CryptoError.InvalidParameters
+        }
+        return iv.baseAddress
+    }
+    
+    private init(operation: Cryptor.Operation, key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>?, padding: Cryptor.Padding) throws {
+        guard Cipher.isValidKeySize(key.count) else {
+            throw CryptoError.InvalidParameters
+        }
+        let iv = try TypedCryptor.validatedIV(iv)
+        
+        self.operation = operation
+        self.padding = Mode.supportsPadding ? padding : .None
+        let configuration = Cryptor.Configuration(mode: CCMode(rawValue: Mode.identifier)!, algorithm: CCAlgorithm(rawValue: Cipher.identifier)!, padding: self.padding.rawValue, iv: iv, tweak: nil, numberOfRounds: nil)
+        try Cryptor.createCryptor(operation: operation.rawValue, configuration: configuration, key: key, cryptor: &rawPointer)
+    }
+    
+    deinit {
+        CCCryptorRelease(rawPointer)
+    }
+    
+    /// Create a context for encryption.
+    ///
+    /// - parameter key: Raw key material. Its length must be valid for
+    ///   `Cipher`.
+    /// - parameter iv: The initialization vector, `ivLength` bytes long. If
+    ///   `nil`, an all zeroes IV will be used. Ignored if the mode does not
+    ///   take one.
+    /// - parameter padding: The padding to use. Ignored if the mode does not
+    ///   support padding.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` if the key or IV is the wrong
+    ///     length.
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forEncryption key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>? = nil, padding: Cryptor.Padding = .None) throws {
+        try self.init(operation: .Encrypt, key: key, iv: iv, padding: padding)
+    }
+    
+    /// Create a context for decryption.
+    ///
+    /// - seealso: init(forEncryption:iv:padding:)
+    public convenience init(forDecryption key: UnsafeBufferPointer<Void>, iv: UnsafeBufferPointer<Void>? = nil, padding: Cryptor.Padding = .None) throws {
+        try self.init(operation: .Decrypt, key: key, iv: iv, padding: padding)
+    }
+    
+    /// Process (encrypt or decrypt) some data.
+    ///
+    /// - seealso: Cryptor.update(_:output:)
+    public func update(data: UnsafeBufferPointer<Void>, inout output: UnsafeMutableBufferPointer<Void>!) throws -> Int {
+        probe(.Bytes(data.count))
+        return try call {
+            CCCryptorUpdate($0, data.baseAddress, data.count, output?.baseAddress ?? nil, output?.count ?? 0, $1)
+        }
+    }
+    
+    /// Finish an encrypt or decrypt operation, and obtain final data output.
+    ///
+    /// Only produces output when padding is enabled.
+    ///
+    /// - seealso: Cryptor.finalize(_:)
+    public func finalize(inout output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        return try call {
+            CCCryptorFinal($0, output.baseAddress, output.count, $1)
+        }
+    }
+    
+    /// Reinitialize an existing context, possibly with a new initialization
+    /// vector.
+    ///
+    /// - parameter iv: New initialization vector, optional. If present, must
+    ///   be `ivLength` bytes. Ignored if the mode does not take one.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters` to indicate an invalid IV.
+    public func reset(iv: UnsafeBufferPointer<Void>? = nil) throws {
+        let iv = try TypedCryptor.validatedIV(iv)
+        probe(.Reset)
+        try call {
+            CCCryptorReset($0, iv)
+        }
+    }
+    
+    /// Output buffer size, in bytes, required to process `inputLength` bytes
+    /// in one shot.
+    ///
+    /// - seealso: Cryptor.Algorithm.outputLength(forInput:operation:)
+    public func outputLength(forInput inputLength: Int) -> Int {
+        guard Mode.supportsPadding && padding == .PKCS7 && operation == .Encrypt else {
+            return inputLength
+        }
+        return (inputLength / Cipher.blockSize + 1) * Cipher.blockSize
+    }
+    
+}
@@ -0,0 +1,172 @@
+//
+//  XTSSectorCryptor.swift
+//  OneTimePad
+//
+//  Created by Zachary Waldowski on 10/14/15.
+//  Copyright © 2015 Zachary Waldowski. All rights reserved.
+//
+
+import CommonCryptoShim.Private
+import Dispatch
+
+/// Sector-oriented AES-XTS for disk images.
+///
+/// XTS encrypts each fixed-size sector independently, under a tweak derived
+/// from the sector's number, so any sector can be read or rewritten without
+/// touching its neighbours. Rather than creating or resetting a `Cryptor` for
+/// every sector, an `XTSSectorCryptor` keeps a single keyed context and
+/// passes each sector's tweak alongside its data. The tweak is the sector
+/// number as a 128-bit little-endian integer, per IEEE 1619.
+///
+/// Long runs of sectors are split into ranges and processed concurrently,
+/// each range by its own context; the output is byte-for-byte identical to
+/// processing the sectors one at a time.
+///
+/// A given `XTSSectorCryptor` can only be used by one thread at a time.
+public final class XTSSectorCryptor: CCPointer {
+    
+    /// The length of the tweak for each sector, in bytes.
+    private static let tweakLength = kCCBlockSizeAES128
+    
+    /// The direction of this context.
+    public let operation: Cryptor.Operation
+    /// The number of bytes in each sector; a multiple of the block size.
+    public let sectorSize: Int
+    /// The number of sectors processed by each unit of work when a run is
+    /// split across cores.
+    public let sectorsPerChunk: Int
+    
+    private(set) var rawPointer = Cryptor.RawCryptor()
+    private let configuration: Cryptor.Configuration
+    private let key: SecretBytes
+    private let tweakKey: SecretBytes
+    private let queue: dispatch_queue_t
+    
+    private init(operation: Cryptor.Operation, key: UnsafeBufferPointer<Void>, tweakKey: UnsafeBufferPointer<Void>, sectorSize: Int, sectorsPerChunk: Int, queue: dispatch_queue_t) throws {
+        // IEEE 1619 requires the data and tweak keys to be distinct.
+        guard sectorSize >= kCCBlockSizeAES128 && sectorSize % kCCBlockSizeAES128 == 0 && key.count == tweakKey.count && !constantTimeEquals(key.baseAddress, tweakKey.baseAddress, count: key.count) else {
+            throw CryptoError.InvalidParameters
+        }
+        
+        self.operation = operation
+        self.sectorSize = sectorSize
+        self.sectorsPerChunk = max(sectorsPerChunk, 1)
+        self.key = SecretBytes(copying: key)
+        self.tweakKey = SecretBytes(copying: tweakKey)
+        self.queue = queue
+        self.configuration = Cryptor.Configuration(mode: .XTS, algorithm: .AES, padding: .None, iv: nil, tweak: self.tweakKey.buffer, numberOfRounds: nil)
+        try Cryptor.createCryptor(operation: operation.rawValue, configuration: configuration, key: self.key.buffer, cryptor: &rawPointer)
+    }
+    
+    deinit {
+        CCCryptorRelease(rawPointer)
+    }
+    
+    /// Create a context for encrypting sectors.
+    ///
+    /// - parameter key: Raw key material for the data, 16 or 32 bytes.
+    /// - parameter tweakKey: Raw key material for the tweak; the same length
+    ///   as `key`, and different from it.
+    /// - parameter sectorSize: The number of bytes in each sector. Must be a
+    ///   multiple of the AES block size.
+    /// - parameter sectorsPerChunk: The number of sectors to process per unit
+    ///   of work when a run is split across cores.
+    /// - parameter queue: The queue on which ranges of sectors are processed;
+    ///   should be concurrent.
+    /// - throws:
+    ///   - `CryptoError.InvalidParameters`
+    ///   - `CryptoError.CouldNotAllocateMemory`
+    public convenience init(forEncryption key: UnsafeBufferPointer<Void>, tweakKey: UnsafeBufferPointer<Void>, sectorSize: Int = 512, sectorsPerChunk: Int = 512, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) throws {
+        try self.init(operation: .Encrypt, key: key, tweakKey: tweakKey, sectorSize: sectorSize, sectorsPerChunk: sectorsPerChunk, queue: queue)
+    }
+    
+    /// Create a context for decrypting sectors.
+    ///
+    /// - seealso: init(forEncryption:tweakKey:sectorSize:sectorsPerChunk:queue:)
+    public convenience init(forDecryption key: UnsafeBufferPointer<Void>, tweakKey: UnsafeBufferPointer<Void>, sectorSize: Int = 512, sectorsPerChunk: Int = 512, queue: dispatch_queue_t = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0)) throws {
+        try self.init(operation: .Decrypt, key: key, tweakKey: tweakKey, sectorSize: sectorSize, sectorsPerChunk: sectorsPerChunk, queue: queue)
+    }
+    
+    /// Process `count` sectors starting at `sector` with `cryptor`.
+    private func cryptSectors(cryptor: Cryptor.RawCryptor, sector: UInt64, offset: Int, count: Int, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws {
+        var tweak = [UInt8](count: XTSSectorCryptor.tweakLength, repeatedValue: 0)
+        var bytesIn = UnsafePointer<UInt8>(input.baseAddress) + offset * sectorSize
+        var bytesOut = UnsafeMutablePointer<UInt8>(output.baseAddress) + offset * sectorSize
+        
+        probe(.Bytes(count * sectorSize))
+        // Counted from zero, so that a run ending at sector `UInt64.max`
+        // does not overflow its end bound.
+        for step in 0 ..< UInt64(count) {
+            let number = sector + step
+            for index in 0 ..< 8 {
+                tweak[index] = UInt8(truncatingBitPattern: number >> UInt64(index * 8))
+            }
+            
+            try cc_call {
+                switch operation {
+                case .Encrypt:
+                    return CCCryptorEncryptDataBlock(cryptor, tweak, bytesIn, sectorSize, bytesOut)
+                case .Decrypt:
+                    return CCCryptorDecryptDataBlock(cryptor, tweak, bytesIn, sectorSize, bytesOut)
+                }
+            }
+            bytesIn += sectorSize
+            bytesOut += sectorSize
+        }
+    }
+    
+    private func cryptChunk(index: Int, sector: UInt64, sectorCount: Int, input: UnsafeBufferPointer<Void>, output: UnsafeMutableBufferPointer<Void>) throws {
+        let offset = index * sectorsPerChunk
+        let count = min(sectorsPerChunk, sectorCount - offset)
+        
+        var cryptor = Cryptor.RawCryptor()
+        try Cryptor.createCryptor(operation: operation.rawValue, configuration: configuration, key: key.buffer, cryptor: &cryptor)
+        defer {
+            CCCryptorRelease(cryptor)
+        }
+        
+        try cryptSectors(cryptor, sector: sector + UInt64(offset), offset: offset, count: count, input: input, output: output)
+    }
+    
+    /// Encrypt or decrypt a contiguous run of sectors.
+    ///
+    /// - parameter input: The sectors to process. Its length must be a
+    ///   multiple of `sectorSize`.
+    /// - parameter sector: The number of the first sector in `input`.
+    /// - parameter output: The result is written here. Must be allocated by
+    ///   the caller with space for at least `input.count` bytes. Sectors can
+    ///   be processed "in-place", with the same buffer used for input and
+    ///   output.
+    /// - returns: The number of bytes written to `output`.
+    /// - throws:
+    ///   - `CryptoError.MisalignedMemory` if `input` is not a whole number of
+    ///     sectors.
+    ///   - `CryptoError.InvalidParameters` if the sector numbers would run
+    ///     past `UInt64.max`.
+    ///   - `CryptoError.BufferTooSmall` to indicate insufficient space in the
+    ///     `output` buffer.
+    public func process(input: UnsafeBufferPointer<Void>, startingAtSector sector: UInt64, output: UnsafeMutableBufferPointer<Void>) throws -> Int {
+        guard input.count % sectorSize == 0 else {
+            throw CryptoError.MisalignedMemory
+        }
+        guard output.count >= input.count else {
+            throw CryptoError.BufferTooSmall
+        }
+        
+        let sectorCount = input.count / sectorSize
+        guard sectorCount == 0 || UInt64(sectorCount - 1) <= UInt64.max - sector else {
+            throw CryptoError.InvalidParameters
+        }
+        let chunkCount = (sectorCount + sectorsPerChunk - 1) / sectorsPerChunk
+        guard chunkCount > 1 else {
+            try cryptSectors(rawPointer, sector: sector, offset: 0, count: sectorCount, input: input, output: output)
+            return input.count
+        }
+        
+        try concurrentlyApply(chunkCount, queue: queue) { index in
+            try self.cryptChunk(index, sector: sector, sectorCount: sectorCount, input: input, output: output)
+        }
+        return input.count
+    }
+    
+}